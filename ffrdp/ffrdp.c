@@ -1,4 +1,14 @@
+#if !defined(WIN32) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // for recvmmsg/sendmmsg
+#endif
+#if (!defined(CONFIG_DISABLE_PACING) || defined(CONFIG_ENABLE_TXTIME)) && !defined(CONFIG_ENABLE_PACING)
+#define CONFIG_ENABLE_PACING // on by default, bursts of cwnd frames overflow shallow queues of access points, txtime is kernel scheduled pacing and software pacing is its fallback
+#endif
+#if (defined(CONFIG_ENABLE_GSO) || defined(CONFIG_ENABLE_GRO) || defined(CONFIG_ENABLE_IOURING) || defined(CONFIG_ENABLE_ZEROCOPY) || defined(CONFIG_ENABLE_TXTIME)) && !defined(CONFIG_ENABLE_MMSG)
+#define CONFIG_ENABLE_MMSG // gso, gro, io_uring, zerocopy and txtime are built on the sendmmsg/recvmmsg path
+#endif
 #include <stdint.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -12,6 +22,25 @@
 #include <winsock2.h>
 #define usleep(t) Sleep((t) / 1000)
 #define get_tick_count GetTickCount
+static uint64_t get_tick_us() // GetTickCount is too coarse (10-16ms) for pacing
+{
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    if (!freq.QuadPart) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (uint64_t)(now.QuadPart / freq.QuadPart * 1000000 + now.QuadPart % freq.QuadPart * 1000000 / freq.QuadPart);
+}
+#ifdef CONFIG_ENABLE_CC_PROFILE
+static uint64_t get_tick_ns()
+{
+    LARGE_INTEGER freq, now;
+    QueryPerformanceFrequency(&freq); QueryPerformanceCounter(&now);
+    return (uint64_t)((double)now.QuadPart * 1000000000 / freq.QuadPart);
+}
+#endif
+#define ALIGN_CACHELINE      __declspec(align(64)) // must match FFRDP_CACHELINE
+#define aligned_malloc(size, align) _aligned_malloc(size, align)
+#define aligned_free         _aligned_free
 #pragma warning(disable:4996) // disable warnings
 #else
 #include <time.h>
@@ -21,34 +50,131 @@
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <netinet/udp.h>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#ifdef CONFIG_ENABLE_IOURING
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+#ifdef CONFIG_ENABLE_ZEROCOPY
+#include <linux/errqueue.h>
+#endif
+#ifdef CONFIG_ENABLE_TXTIME
+#include <linux/net_tstamp.h>
+#endif
+#ifdef CONFIG_ENABLE_REUSEPORT_CBPF
+#include <linux/filter.h>
+#endif
 #define SOCKET int
 #define closesocket close
 #define stricmp strcasecmp
 #define strtok_s strtok_r
+#define ALIGN_CACHELINE __attribute__((aligned(FFRDP_CACHELINE)))
+#define aligned_free    free
+static void* aligned_malloc(size_t size, size_t align)
+{
+    void *ptr;
+    return posix_memalign(&ptr, align, size) == 0 ? ptr : NULL;
+}
 static uint32_t get_tick_count()
 {
     struct timespec ts;
     clock_gettime(CLOCK_MONOTONIC, &ts);
     return (ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
 }
+static uint64_t get_tick_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts); // same clock as SO_TXTIME
+    return ((uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+#ifdef CONFIG_ENABLE_CC_PROFILE
+static uint64_t get_tick_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec);
+}
+#endif
 #endif
 
 #define FFRDP_MAX_MSS       (1500 - 8) // should align to 4 bytes and <= 1500 - 8
 #define FFRDP_MIN_RTO        20
 #define FFRDP_MAX_RTO        2000
+#ifdef CONFIG_ENABLE_LARGE_BDP // windows of thousands of frames, e.g. 1Gbps x 50ms, the receive window above 255 frames is negotiated with peer
+#define FFRDP_MAX_WAITSND    8192
+#define FFRDP_SEND_RING_SIZE 16384 // < 2^23, seq is 24 bits on wire and windows must stay within half of it
+#define FFRDP_RECV_RING_SIZE 8192
+#else
 #define FFRDP_MAX_WAITSND    256
+#define FFRDP_SEND_RING_SIZE 512 // slots of send window indexed by seq, power of 2 and > FFRDP_MAX_WAITSND + 25 (frames acked out of order)
+#define FFRDP_RECV_RING_SIZE 256 // slots of receive reorder window indexed by seq, power of 2 and >= 64, frames beyond are dropped
+#endif
 #define FFRDP_QUERY_CYCLE    500
 #define FFRDP_FLUSH_TIMEOUT  500
 #define FFRDP_DEAD_TIMEOUT   5000
 #define FFRDP_MIN_CWND_SIZE  1
 #define FFRDP_DEF_CWND_SIZE  32
+#ifdef CONFIG_ENABLE_LARGE_BDP
+#define FFRDP_MAX_CWND_SIZE  8192
+#else
 #define FFRDP_MAX_CWND_SIZE  64
-#define FFRDP_RECVBUF_SIZE  (128 * (FFRDP_MAX_MSS + 0))
+#endif
+#define FFRDP_EXT_TRIES      8     // ext query is sent at most this many times (once per FFRDP_QUERY_CYCLE) to find out if peer supports ack ext
+#define FFRDP_TARGET_DELAY   25    // ms, default queueing delay target of delay based congestion control
+#define FFRDP_BASE_HISTORY   10    // minutes, base rtt is min rtt of last 10 minutes
+#define FFRDP_RECVBUF_SIZE  (128 * (FFRDP_MAX_MSS + 0)) // default size of receive buffer
+#define FFRDP_RECVBUF_MAX   (1 << 30)
+#ifdef CONFIG_ENABLE_LARGE_BDP
+#define FFRDP_RECVBUF_DEFMAX (FFRDP_RECV_RING_SIZE * FFRDP_MAX_MSS) // default max size receive buffer grows to, a full receive window
+#else
+#define FFRDP_RECVBUF_DEFMAX FFRDP_RECVBUF_SIZE
+#endif
+#define FFRDP_RECVBUF_IDLE   1000 // ms, an empty receive buffer is released after idle for this time
+#ifdef CONFIG_ENABLE_LARGE_BDP
+#define FFRDP_UDPSBUF_SIZE  (4 << 20)
+#define FFRDP_UDPRBUF_SIZE  (8 << 20)
+#else
 #define FFRDP_UDPSBUF_SIZE  (64  * (FFRDP_MAX_MSS + 6))
 #define FFRDP_UDPRBUF_SIZE  (128 * (FFRDP_MAX_MSS + 6))
+#endif
 #define FFRDP_SELECT_SLEEP   0
 #define FFRDP_SELECT_TIMEOUT 10000
 #define FFRDP_USLEEP_TIMEOUT 1000
+#ifndef FFRDP_MMSG_BATCH
+#define FFRDP_MMSG_BATCH     16 // max datagrams per recvmmsg, only used when CONFIG_ENABLE_MMSG is defined (linux only)
+#endif
+#define FFRDP_TXQ_SIZE       128 // max datagrams queued in one update before they are flushed
+#define FFRDP_GSO_MAXSEGS    64    // max segments of one gso datagram
+#define FFRDP_GSO_MAXSIZE    65507 // max size of one gso datagram
+#define FFRDP_GRO_BUFSIZE    65535 // size of each pre-posted receive buffer when gro is enabled
+#define FFRDP_IOURING_SQSIZE 256   // io_uring submission queue size, should be > FFRDP_TXQ_SIZE
+#define FFRDP_IOURING_NBUFS  64    // number of provided receive buffers, should be power of 2
+#define FFRDP_IOURING_UD_RECV 0xFFFFFFFF // user_data of multishot recvmsg, user_data of send is its tx queue index
+#define FFRDP_ZC_MAXPEND     1024  // max frame nodes waiting for zerocopy completion, should be power of 2
+#ifndef FFRDP_LOOP_MAXCLIENTS
+#define FFRDP_LOOP_MAXCLIENTS 1024 // max contexts of one ffrdp_loop, new clients beyond it are dropped
+#endif
+#define FFRDP_LOOP_MAXPENDING 64   // max accepted contexts not taken by ffrdp_loop_accept yet, new clients beyond it are dropped
+#define FFRDP_LOOP_MAXRXPEND  64   // max datagrams a listener hands over to one context before its next update, covers initial cwnd burst with fec
+#ifdef CONFIG_ENABLE_IOURING
+#define IOURING_HEADROOM ((int)(sizeof(struct io_uring_recvmsg_out) + sizeof(struct sockaddr_in))) // recvmsg header before frame data in provided buffer
+#define FFRDP_POOL_NODESIZE  (IOURING_HEADROOM + 4 + FFRDP_MAX_MSS + 2) // data size of pooled frame node, fits any data, fec or received frame, and io_uring receive buffer
+#else
+#define FFRDP_POOL_NODESIZE  (4 + FFRDP_MAX_MSS + 2) // data size of pooled frame node, fits any data, fec or received frame
+#endif
+#define FFRDP_POOL_MAXFREE   (FFRDP_MAX_CWND_SIZE + FFRDP_RECVBUF_SIZE / FFRDP_MAX_MSS) // high-water mark of cached free nodes, a full send and recv window
+#define FFRDP_PACE_HORIZON   1000  // us, software pacing releases frames due within one update sleep
+#define FFRDP_TXTIME_HORIZON 4000  // us, how far ahead frames are handed to kernel with SCM_TXTIME
+
+#define FFRDP_CACHELINE      64    // cache line size, FFRDPCONTEXT blocks are aligned to it
+#define FFRDP_HOT_LINES      4     // cache lines of FFRDPCONTEXT hot block, checked at compile time
+#define FFRDP_WHEEL_BITS0    8     // timer wheel level 0 has (1 << bits) slots of 1ms
+#define FFRDP_WHEEL_SLOTS0   (1 << FFRDP_WHEEL_BITS0)
+#define FFRDP_WHEEL_SLOTS1   64    // timer wheel level 1 slots of FFRDP_WHEEL_SLOTS0 ms, covers 16s, should be multiple of 32
 
 #define MIN(a, b)               ((a) < (b) ? (a) : (b))
 #define MAX(a, b)               ((a) > (b) ? (a) : (b))
@@ -61,9 +187,17 @@ enum {
     FFRDP_FRAME_TYPE_FEC2,       // fec2  frame
     FFRDP_FRAME_TYPE_FEC32 = 32, // fec32 frame
     FFRDP_FRAME_TYPE_ACK   = 33, // ack   frame
-    FFRDP_FRAME_TYPE_QUERY = 34, // query frame
+    FFRDP_FRAME_TYPE_QUERY = 34, // query frame, second byte FFRDP_QUERY_EXT tells peer that ack ext is supported
+    FFRDP_FRAME_TYPE_ACKEXT= 35, // ack ext frame, ack frame with receive window scale in ninth byte, only sent to peer supporting it
 };
+#define FFRDP_QUERY_EXT 0x01
+
+typedef struct tagFFRDP_TIMER {
+    struct tagFFRDP_TIMER *next, **pprev; // pprev is NULL if timer is not armed
+    uint32_t expire; // tick when timer fires
+} FFRDP_TIMER;
 
+struct tagFFRDP_NODE_POOL;
 typedef struct tagFFRDP_FRAME_NODE {
     struct tagFFRDP_FRAME_NODE *next;
     struct tagFFRDP_FRAME_NODE *prev;
@@ -72,56 +206,216 @@ typedef struct tagFFRDP_FRAME_NODE {
     #define FLAG_FIRST_SEND     (1 << 0) // after frame first send, this flag will be set
     #define FLAG_TIMEOUT_RESEND (1 << 1) // data frame wait ack timeout and be resend
     #define FLAG_FAST_RESEND    (1 << 2) // data frame need fast resend when next update
+    #define FLAG_ZC_PENDING     (1 << 3) // frame data is pinned by a zerocopy send, must not be modified or freed
+    #define FLAG_ZC_ORPHAN      (1 << 4) // frame is freed (acked) while pinned, free it when zerocopy completes
+    #define FLAG_APP_LIMITED    (1 << 5) // frame is sent when sender has no data to fill cwnd, its delivery rate sample is app limited
     uint32_t flags;        // frame flags
     uint32_t tick_1sts;    // frame first time send tick
     uint32_t tick_send;    // frame send tick
     uint32_t tick_timeout; // frame ack timeout tick
+    uint32_t dlv_bytes;    // delivered bytes of context when frame is sent, for delivery rate sample
+    uint32_t dlv_tick;     // us tick of last delivery when frame is sent
+    uint32_t dlv_first;    // us send tick of last delivered frame when frame is sent
+    uint32_t dlv_sent;     // us tick of frame send
+    struct tagFFRDP_NODE_POOL *pool; // pool this node returns to when freed, NULL for malloc'ed node
+    FFRDP_TIMER timer;     // rto timer of data frame in send window
 } FFRDP_FRAME_NODE;
+#define TIMER_NODE(t) ((FFRDP_FRAME_NODE*)((uint8_t*)(t) - offsetof(FFRDP_FRAME_NODE, timer)))
 
+typedef struct tagFFRDP_NODE_POOL {
+    FFRDP_FRAME_NODE *free; // free nodes linked by next
+    uint32_t          num;  // number of free nodes
+    uint32_t          hit, miss;
+} FFRDP_NODE_POOL;
+
+enum { TXQ_DATA_1ST, TXQ_DATA_RESEND, TXQ_FEC, TXQ_CTRL };
 typedef struct {
-    uint8_t  recv_buff[FFRDP_RECVBUF_SIZE];
-    int32_t  recv_size, recv_head, recv_tail;
+    FFRDP_FRAME_NODE *node; // data frame node, or fec frame node owned by tx queue
+    uint8_t  type;          // TXQ_DATA_1ST, TXQ_DATA_RESEND, TXQ_FEC or TXQ_CTRL
+    uint8_t  ctrl[12];      // ack or query frame data
+    uint16_t size;          // datagram size
+    uint32_t flags, tick_send, tick_timeout, rto; // data frame states before queued, restored if send failed
+    uint64_t txtime;        // departure time in us for SCM_TXTIME, 0 to send now
+} FFRDP_TXQ_ITEM;
+
+struct tagFFRDPCONTEXT;
+typedef struct {
+    char     *name;
+    void     (*init       )(struct tagFFRDPCONTEXT *ffrdp);
+    void     (*on_ack     )(struct tagFFRDPCONTEXT *ffrdp, uint32_t acked, uint32_t rttm); // frames newly acked by one ack frame, rttm is rtt sample or -1
+    void     (*on_loss    )(struct tagFFRDPCONTEXT *ffrdp); // frame loss detected by selective ack, or send failed
+    void     (*on_rto     )(struct tagFFRDPCONTEXT *ffrdp); // frame resent by rto
+    void     (*on_send    )(struct tagFFRDPCONTEXT *ffrdp, FFRDP_FRAME_NODE *frame); // data frame first send, may be NULL
+    uint64_t (*pacing_rate)(struct tagFFRDPCONTEXT *ffrdp); // bytes per second, 0 to send without pacing
+    uint32_t (*cwnd       )(struct tagFFRDPCONTEXT *ffrdp); // frames allowed in flight
+} FFRDP_CC_OPS; // congestion controller, it owns cwnd and ssthresh
+
+typedef struct {
+    uint32_t cnt;      // acked frames counted toward next cwnd increment
+    uint32_t recover;  // send_next when recovery started, recovery ends when it is acked
+    uint32_t recovery; // CC_RECOVERY_FAST holds cwnd, CC_RECOVERY_LOSS (after rto) grows cwnd from 1
+    uint32_t min_rtt;  // ms, minimum rtt sample, -1 if none
+    union {
+        struct {
+            uint32_t wmax, origin, k, epoch; // window before last reduction, origin of cubic function, ms to reach origin, tick of epoch start
+            uint32_t west;  // estimated reno window, in 1/1024 frames
+            uint32_t round_end, rtt_cur, rtt_last, rtt_cnt; // hystart++ round and min rtt of current and last round
+            uint32_t css, css_base, css_rounds; // hystart++ conservative slow start
+        } cubic;
+        struct {
+            uint32_t mode, round, round_end, round_start; // BBR_*, round trip count, a round ends when send_next at its start is acked
+            uint32_t bw[10], btlbw; // max delivery rate of last BBR_BW_ROUNDS rounds, bottleneck bandwidth is max of them, bytes per second
+            uint32_t full_bw, full_bw_cnt, filled; // startup ends when btlbw stops growing 25% for 3 rounds
+            uint32_t min_rtt, min_rtt_tick; // us, windowed min rtt and ms tick it's sampled
+            uint32_t probe_rtt_done, probe_rtt_round; // ms tick probe rtt ends, a round passed in probe rtt
+            uint32_t pacing_gain, cwnd_gain, cycle_idx, cycle_tick; // gains in 1/BBR_UNIT, probe bw gain cycle
+            uint32_t prior_cwnd, inrecovery; // cwnd restored after recovery or probe rtt
+        } bbr;
+        struct {
+            int32_t frac; // fraction of cwnd change, in 1/1024 frames
+        } ledbat;
+    } u;
+} FFRDP_CC_STATE;
+
+typedef struct tagFFRDPCONTEXT {
+    // hot block, fields read or written for every packet and update, starts at cache line 0 and fits in FFRDP_HOT_LINES
     #define FLAG_SERVER    (1 << 0)
     #define FLAG_CONNECTED (1 << 1)
     #define FLAG_FLUSH     (1 << 2)
     #define FLAG_TX_AES256 (1 << 3)
     #define FLAG_RX_AES256 (1 << 4)
+    #define FLAG_UDP_GSO   (1 << 5)
+    #define FLAG_UDP_GRO   (1 << 6)
+    #define FLAG_IOURING   (1 << 7)
+    #define FLAG_EVLOOP    (1 << 8) // context is driven by ffrdp_loop, ffrdp_update doesn't sleep
+    #define FLAG_READABLE  (1 << 9) // ffrdp_loop found socket readable
+    #define FLAG_UDP_CONNECTED (1 << 10) // udp socket is connected to peer, kernel filters other sources
+    #define FLAG_ZEROCOPY  (1 << 11) // data frames are sent with MSG_ZEROCOPY
+    #define FLAG_TXTIME    (1 << 12) // data frames are paced by kernel qdisc with SCM_TXTIME
+    #define FLAG_ACCEPTED      (1 << 13) // context is created by ffrdp_loop listener for a new client
+    #define FLAG_PEER_RESET    (1 << 14) // peer of accepted context came back as a new client, socket is closed and context is dead
+    #define FLAG_SEND_RESERVED (1 << 15) // caller is writing into cur_new_node, it must not be flushed
+    #define FLAG_RECV_PEEKED   (1 << 16) // caller holds iovecs of ffrdp_recv_peek, recv_buff must not be moved or freed until ffrdp_recv_consume
+    #define FLAG_PEER_ACKEXT   (1 << 17) // peer sent ext query or ack ext, it understands ack ext with scaled receive window
     uint32_t flags;
     SOCKET   udp_fd;
-    struct   sockaddr_in server_addr;
-    struct   sockaddr_in client_addr;
-
-    FFRDP_FRAME_NODE *send_list_head;
-    FFRDP_FRAME_NODE *send_list_tail;
-    FFRDP_FRAME_NODE *recv_list_head;
-    FFRDP_FRAME_NODE *recv_list_tail;
-    FFRDP_FRAME_NODE *cur_new_node;
-    uint32_t          cur_new_size;
-    uint32_t          cur_new_tick;
-    uint32_t send_seq; // send seq
-    uint32_t recv_seq; // send seq
-    uint32_t wait_snd; // data frame number wait to send
+    uint32_t send_seq;  // send seq
+    uint32_t send_head; // seq of oldest unacked frame, send_head == send_seq if send window is empty
+    uint32_t send_next; // seq of first frame not sent yet, frames before it are all sent
+    uint32_t recv_seq;  // recv seq
+    uint32_t wait_snd;  // data frame number wait to send
     uint32_t rttm, rtts, rttd, rto;
     uint32_t rmss, smss, swnd, cwnd, ssthresh;
+    const FFRDP_CC_OPS *cc;
+    uint32_t dlv_bytes, dlv_tick, dlv_first; // bytes acked so far, us tick of last delivery, us send tick of last delivered frame
+    uint32_t dlv_applimited; // samples are app limited until dlv_bytes passes it, 0 if not app limited
     uint32_t tick_recv_ack;
-    uint32_t tick_send_query;
-    uint32_t tick_ffrdp_dump;
-
-    uint8_t  fec_txbuf[4 + FFRDP_MAX_MSS + 2];
-    uint8_t  fec_rxbuf[4 + FFRDP_MAX_MSS + 2];
+    FFRDP_FRAME_NODE *cur_new_node;
+    uint32_t          cur_new_size;
+    uint32_t          cur_new_tick;
+    uint8_t *recv_buff;     // allocated on first data, released when empty and idle
+    int32_t  recv_size, recv_head, recv_tail;
+    int32_t  recv_bufsize, recv_bufmin, recv_bufmax; // current, initial and max size of recv_buff
+    uint32_t recv_tick;     // last time data was put into recv_buff
+    int32_t  txq_num;
     uint8_t  fec_txredundancy, fec_rxredundancy;
     uint16_t fec_txseq;
     uint16_t fec_rxseq;
     uint16_t fec_rxcnt;
     uint32_t fec_rxmask;
+#ifdef CONFIG_ENABLE_PACING
+    uint64_t pace_next;   // us, earliest departure time of next data frame
+    uint64_t pace_txtime; // us, departure time of the data frame being queued, 0 if not kernel paced
+    int32_t  pace_rate;   // bytes per second pinned by application, 0 follows congestion controller, < 0 disables pacing
+#endif
+    FFRDP_NODE_POOL pool; // frame nodes of this context
+    uint32_t     wheel_tick; // timers of ticks before it have fired
+    FFRDP_TIMER *timer_due;  // rto expired or fast resend frames waiting for resend
+
+    // ack block, congestion controller and delay estimator, touched once per ack frame
+    ALIGN_CACHELINE FFRDP_CC_STATE cc_state;
+    uint32_t rs_rate, rs_rtt, rs_applimited; // max delivery rate in bytes per second and min us rtt sampled by current ack, 0 and -1 if none
+    uint32_t srtt_us, base_rtt, qdelay; // us, smoothed rtt, windowed min rtt and queueing delay estimate (srtt_us - base_rtt), 0 if no sample
+    uint32_t target_delay; // us, queueing delay target of delay based congestion control
+    uint32_t base_hist[FFRDP_BASE_HISTORY], base_idx, base_tick; // us min rtt of each of last minutes, current minute and its ms start tick
+    uint32_t tick_send_query;
+    uint32_t tick_send_ext, ext_tries; // ext query of CONFIG_ENABLE_LARGE_BDP
+
+    // windows and tx queue, indexed by seq, only the touched slots are loaded
+    ALIGN_CACHELINE uint32_t recv_bits[FFRDP_RECV_RING_SIZE / 32]; // presence bitmap of recv_ring
+    FFRDP_FRAME_NODE *send_ring[FFRDP_SEND_RING_SIZE]; // frame of seq is in slot seq & (size - 1), NULL if acked
+    FFRDP_FRAME_NODE *recv_ring[FFRDP_RECV_RING_SIZE]; // out of order frames waiting for recv_seq, frame of seq is in slot seq & (size - 1)
+    FFRDP_TXQ_ITEM    txq[FFRDP_TXQ_SIZE]; // datagrams of current update, flushed by ffrdp_txq_flush
+    FFRDP_TIMER      *wheel[FFRDP_WHEEL_SLOTS0 + FFRDP_WHEEL_SLOTS1]; // timer lists of level 0 and level 1 slots
+    uint32_t          wheel_bits[(FFRDP_WHEEL_SLOTS0 + FFRDP_WHEEL_SLOTS1) / 32]; // slots which may be non-empty
+    FFRDP_TIMER       timer_flush; // flush partly filled cur_new_node
+    FFRDP_TIMER       timer_query; // query cycle of remote receive window
+    FFRDP_TIMER       timer_dead;  // dead link deadline of oldest unacked frame, wakes up caller to check ffrdp_isdead
+    FFRDP_TIMER       timer_idle;  // release of empty recv_buff
+
+    // cold block, addresses, config and scratch buffers
+    ALIGN_CACHELINE struct sockaddr_in server_addr;
+    struct   sockaddr_in client_addr;
+    void    *loop;    // ffrdp_loop this context is registered to
+    SOCKET   loop_fd; // fd polled by ffrdp_loop
+    FFRDP_FRAME_NODE *rxpend;     // datagrams received by ffrdp_loop listener for this context, processed before those of socket
+    int32_t           rxpend_out; // last frame returned by ffrdp_recv_next is from rxpend
+    uint32_t tick_ffrdp_dump;
+    uint8_t  fec_txbuf[4 + FFRDP_MAX_MSS + 4]; // padded to 4 bytes, fec_rxbuf stays aligned for uint32_t xor
+    uint8_t  fec_rxbuf[4 + FFRDP_MAX_MSS + 2];
 
 #ifdef CONFIG_ENABLE_AES256
     AES_KEY  aes_encrypt_key;
     AES_KEY  aes_decrypt_key;
 #endif
 
+#ifdef CONFIG_ENABLE_MMSG
+    FFRDP_FRAME_NODE  *rxmmsg_node[FFRDP_MMSG_BATCH]; // pre-posted receive frame nodes
+    struct mmsghdr     rxmmsg_hdr [FFRDP_MMSG_BATCH];
+    struct iovec       rxmmsg_iov [FFRDP_MMSG_BATCH];
+    struct sockaddr_in rxmmsg_addr[FFRDP_MMSG_BATCH];
+    int32_t            rxmmsg_idx, rxmmsg_num;
+#ifdef CONFIG_ENABLE_GRO
+    uint64_t           rxmmsg_ctl[FFRDP_MMSG_BATCH][(CMSG_SPACE(sizeof(int)) + 7) / 8]; // UDP_GRO cmsg
+    FFRDP_FRAME_NODE  *rxgro_node; // pooled frame node current gro segment is copied to
+    int32_t            rxgro_out, rxgro_off, rxgro_seg;
+#endif
+    struct mmsghdr     txmmsg_hdr[FFRDP_TXQ_SIZE];
+    struct iovec       txmmsg_iov[FFRDP_TXQ_SIZE];
+    uint16_t           txmmsg_cnt[FFRDP_TXQ_SIZE]; // number of tx queue items carried by each mmsghdr
+#else
+    FFRDP_FRAME_NODE  *rxnode;     // pre-posted receive frame node, reused until it is handed off to recv_ring
+    int32_t            rxnode_out; // rxnode was returned by last ffrdp_recv_frame
+#endif
+#if defined(CONFIG_ENABLE_GSO) || defined(CONFIG_ENABLE_TXTIME)
+    uint64_t           txmmsg_ctl[FFRDP_TXQ_SIZE][(CMSG_SPACE(sizeof(uint16_t)) + CMSG_SPACE(sizeof(uint64_t)) + 7) / 8]; // UDP_SEGMENT and SCM_TXTIME cmsg
+#endif
+#ifdef CONFIG_ENABLE_IOURING
+    int32_t              iour_fd;
+    uint8_t             *iour_ring;
+    size_t               iour_ringsize;
+    uint32_t             iour_sqentries;
+    uint32_t            *iour_sqhead, *iour_sqtail, *iour_sqmask, *iour_sqarray;
+    uint32_t            *iour_cqhead, *iour_cqtail, *iour_cqmask;
+    struct io_uring_sqe *iour_sqes;
+    struct io_uring_cqe *iour_cqes;
+    struct io_uring_buf_ring *iour_bufring;
+    uint16_t             iour_buftail;
+    FFRDP_FRAME_NODE    *iour_bufnode[FFRDP_IOURING_NBUFS]; // provided receive buffers, frame data follows recvmsg header
+    uint32_t             iour_rxq[FFRDP_IOURING_NBUFS];     // buffer id of completed receives
+    int32_t              iour_rxhead, iour_rxnum, iour_rxout, iour_armed, iour_bufmiss; // iour_bufmiss: buffers failed to allocate, retried by next receive
+    int32_t              iour_tosubmit, iour_txpending, iour_txmsgs; // iour_txmsgs: datagrams of last flush still owned by kernel
+    int32_t              iour_txres[FFRDP_TXQ_SIZE];
+    struct msghdr        iour_rxmsg;
+#endif
+#ifdef CONFIG_ENABLE_ZEROCOPY
+    struct { uint32_t id; FFRDP_FRAME_NODE *node; } zc_pend[FFRDP_ZC_MAXPEND]; // frame nodes pinned by zerocopy sends, in id order
+    uint32_t             zc_head, zc_num, zc_nextid;
+#endif
+
+    // counters, on their own cache lines so ffrdp_dump from another thread doesn't share lines with hot block
     #define DEADLINK_SENDERR_THRESHOLD 300
-    uint32_t counter_udpsenderr;
+    ALIGN_CACHELINE uint32_t counter_udpsenderr;
     uint32_t counter_send_bytes;
     uint32_t counter_recv_bytes;
     uint32_t counter_send_1sttime;
@@ -136,8 +430,25 @@ typedef struct {
     uint32_t counter_fec_rx;
     uint32_t counter_fec_ok;
     uint32_t counter_fec_failed;
+    uint32_t counter_recv_syscall;
+    uint32_t counter_recv_packet;
+    uint32_t counter_send_syscall;
+    uint32_t counter_send_packet;
+    uint32_t counter_zc_send;
+    uint32_t counter_zc_copied;
+    uint32_t counter_pace_wait;
+    uint32_t counter_cc_ack;
+    uint32_t counter_qdelay_max; // us
+    uint64_t counter_cc_ack_ns; // time spent in on_ack of congestion controller, with CONFIG_ENABLE_CC_PROFILE
+    uint32_t counter_cc_ack_last;    // counter_cc_ack and counter_cc_ack_ns at last ffrdp_dump, for cost per ack of each dump interval
+    uint64_t counter_cc_ack_ns_last;
     uint32_t reserved;
 } FFRDPCONTEXT;
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+_Static_assert(offsetof(FFRDPCONTEXT, cc_state) <= FFRDP_HOT_LINES * FFRDP_CACHELINE, "hot block of FFRDPCONTEXT exceeds FFRDP_HOT_LINES");
+#else
+typedef char FFRDP_HOT_BLOCK_CHECK[offsetof(FFRDPCONTEXT, cc_state) <= FFRDP_HOT_LINES * FFRDP_CACHELINE ? 1 : -1]; // hot block of FFRDPCONTEXT exceeds FFRDP_HOT_LINES if it fails
+#endif
 
 static uint32_t ringbuf_write(uint8_t *rbuf, uint32_t maxsize, uint32_t tail, uint8_t *src, uint32_t len)
 {
@@ -161,6 +472,33 @@ static uint32_t ringbuf_read(uint8_t *rbuf, uint32_t maxsize, uint32_t head, uin
     return len2 ? len2 : head + len1;
 }
 
+static int recvbuf_reserve(FFRDPCONTEXT *ffrdp, int size) // make room for size more bytes in recv_buff, allocate or grow it up to recv_bufmax
+{
+    uint8_t *buf;
+    int32_t  newsize;
+    if (ffrdp->recv_buff && ffrdp->recv_bufsize - ffrdp->recv_size >= size) return 0;
+    if (ffrdp->flags & FLAG_RECV_PEEKED) return -1; // grow after peeked data is consumed, frames wait in recv_ring
+    newsize = ffrdp->recv_buff ? MIN(ffrdp->recv_bufmax, MAX(ffrdp->recv_bufsize * 2, ffrdp->recv_size + size)) : ffrdp->recv_bufsize;
+    if (newsize - ffrdp->recv_size < size || !(buf = malloc(newsize))) return -1;
+    if (ffrdp->recv_buff) {
+        ringbuf_read(ffrdp->recv_buff, ffrdp->recv_bufsize, ffrdp->recv_head, buf, ffrdp->recv_size); // linearize data to the new buffer
+        free(ffrdp->recv_buff);
+    }
+    ffrdp->recv_buff    = buf;
+    ffrdp->recv_bufsize = newsize;
+    ffrdp->recv_head    = 0;
+    ffrdp->recv_tail    = ffrdp->recv_size;
+    return 0;
+}
+
+static void recvbuf_release(FFRDPCONTEXT *ffrdp) // release empty recv_buff, it is allocated again with initial size on next data
+{
+    free(ffrdp->recv_buff);
+    ffrdp->recv_buff    = NULL;
+    ffrdp->recv_bufsize = ffrdp->recv_bufmin;
+    ffrdp->recv_head    = ffrdp->recv_tail = 0;
+}
+
 static int seq_distance(uint32_t seq1, uint32_t seq2) // calculate seq distance
 {
     int c = seq1 - seq2;
@@ -169,17 +507,55 @@ static int seq_distance(uint32_t seq1, uint32_t seq2) // calculate seq distance
     else return c;
 }
 
-static FFRDP_FRAME_NODE* frame_node_new(int type, int size) // create a new frame node
+static FFRDP_FRAME_NODE* frame_node_new(FFRDP_NODE_POOL *pool, int type, int size) // create a new frame node, from pool if it fits
 {
-    FFRDP_FRAME_NODE *node = malloc(sizeof(FFRDP_FRAME_NODE) + 4 + size + (type <= FFRDP_FRAME_TYPE_SHORT ? 0 : 2));
-    if (!node) return NULL;
+    FFRDP_FRAME_NODE *node;
+    if (4 + size + 2 > FFRDP_POOL_NODESIZE) pool = NULL;
+    if (pool && pool->free) {
+        node = pool->free; pool->free = node->next; pool->num--; pool->hit++;
+    } else {
+        if (pool) pool->miss++;
+        node = malloc(sizeof(FFRDP_FRAME_NODE) + (pool ? FFRDP_POOL_NODESIZE : 4 + size + (type <= FFRDP_FRAME_TYPE_SHORT ? 0 : 2)));
+        if (!node) return NULL;
+    }
     memset(node, 0, sizeof(FFRDP_FRAME_NODE));
+    node->pool    = pool;
     node->size    = 4 + size + (type <= FFRDP_FRAME_TYPE_SHORT ? 0 : 2);
     node->data    = (uint8_t*)node + sizeof(FFRDP_FRAME_NODE);
     node->data[0] = type;
     return node;
 }
 
+static void timer_del(FFRDP_TIMER *t)
+{
+    if (!t->pprev) return;
+    if ((*t->pprev = t->next)) t->next->pprev = t->pprev;
+    t->next = NULL; t->pprev = NULL;
+}
+
+static void timer_link(FFRDP_TIMER **head, FFRDP_TIMER *t)
+{
+    timer_del(t);
+    if ((t->next = *head)) t->next->pprev = &t->next;
+    *head = t; t->pprev = head;
+}
+
+static void frame_node_free(FFRDP_FRAME_NODE *node)
+{
+    timer_del(&node->timer);
+    if (node->flags & FLAG_ZC_PENDING) { node->flags |= FLAG_ZC_ORPHAN; return; } // still pinned by kernel, freed when zerocopy completes
+    if (node->pool && node->pool->num < FFRDP_POOL_MAXFREE) {
+        node->next = node->pool->free; node->pool->free = node; node->pool->num++;
+    } else free(node);
+}
+
+static void node_pool_free(FFRDP_NODE_POOL *pool)
+{
+    FFRDP_FRAME_NODE *node;
+    while ((node = pool->free)) { pool->free = node->next; free(node); }
+    pool->num = 0;
+}
+
 #ifdef CONFIG_ENABLE_AES256
 static void frame_node_encrypt(FFRDP_FRAME_NODE *node, AES_KEY *key, int enc)
 {
@@ -195,79 +571,1125 @@ static int frame_payload_size(FFRDP_FRAME_NODE *node) {
     return  node->size - 4 - (node->data[0] <= FFRDP_FRAME_TYPE_SHORT ? 0 : 2);
 }
 
-static void list_enqueue(FFRDP_FRAME_NODE **head, FFRDP_FRAME_NODE **tail, FFRDP_FRAME_NODE *node)
+#define SEND_RING_SLOT(ffrdp, seq) ((ffrdp)->send_ring[(seq) & (FFRDP_SEND_RING_SIZE - 1)])
+static FFRDP_FRAME_NODE* send_ring_next(FFRDPCONTEXT *ffrdp, uint32_t *seq) // find first unacked frame from *seq, NULL if there is none
 {
-    FFRDP_FRAME_NODE *p;
-    uint32_t seqnew, seqcur;
-    int      dist;
-    if (*head == NULL) {
-        *head = node;
-        *tail = node;
-    } else {
-        seqnew = GET_FRAME_SEQ(node);
-        for (p=*tail; p; p=p->prev) {
-            seqcur = GET_FRAME_SEQ(p);
-            dist   = seq_distance(seqnew, seqcur);
-            if (dist == 0) return;
-            if (dist >  0) {
-                if (p->next) p->next->prev = node;
-                else *tail = node;
-                node->next = p->next;
-                node->prev = p;
-                p->next    = node;
-                return;
+    for (; *seq != ffrdp->send_seq; (*seq)++) {
+        if (SEND_RING_SLOT(ffrdp, *seq)) return SEND_RING_SLOT(ffrdp, *seq);
+    }
+    return NULL;
+}
+
+#define RECV_RING_SLOT(ffrdp, seq) ((ffrdp)->recv_ring[(seq) & (FFRDP_RECV_RING_SIZE - 1)])
+#define RECV_RING_TEST(ffrdp, seq) ((ffrdp)->recv_bits[((seq) & (FFRDP_RECV_RING_SIZE - 1)) / 32] &  (1u << ((seq) & 31)))
+#define RECV_RING_FLIP(ffrdp, seq) ((ffrdp)->recv_bits[((seq) & (FFRDP_RECV_RING_SIZE - 1)) / 32] ^= (1u << ((seq) & 31)))
+static uint32_t recv_ring_bits(FFRDPCONTEXT *ffrdp, uint32_t seq) // 24 presence bits of frames from seq
+{
+    uint32_t idx = seq & (FFRDP_RECV_RING_SIZE - 1), w = idx / 32;
+    uint64_t v   = ffrdp->recv_bits[w] | (uint64_t)ffrdp->recv_bits[(w + 1) % (FFRDP_RECV_RING_SIZE / 32)] << 32;
+    return (uint32_t)(v >> (idx & 31)) & 0xFFFFFF;
+}
+
+static int bitmap_find(uint32_t *bits, int start, int n) // distance from start to first set bit in a ring of n bits, -1 if none
+{
+    int i, b;
+    for (i=0; i<n; ) {
+        b = (start + i) % n;
+        if (!(bits[b / 32] >> (b % 32))) { i += 32 - b % 32; continue; } // skip rest of empty word
+        if (bits[b / 32] & (1u << (b % 32))) return i;
+        i++;
+    }
+    return -1;
+}
+
+static void timer_add(FFRDPCONTEXT *ffrdp, FFRDP_TIMER *t, uint32_t expire) // arm or re-arm timer, expired timer fires in next ffrdp_timer_run
+{
+    int32_t d = (int32_t)(expire - ffrdp->wheel_tick), slot;
+    if (d < FFRDP_WHEEL_SLOTS0) slot = (d < 0 ? ffrdp->wheel_tick : expire) & (FFRDP_WHEEL_SLOTS0 - 1);
+    else slot = FFRDP_WHEEL_SLOTS0 + (((ffrdp->wheel_tick + MIN(d, (FFRDP_WHEEL_SLOTS1 - 1) * FFRDP_WHEEL_SLOTS0 - 1)) >> FFRDP_WHEEL_BITS0) & (FFRDP_WHEEL_SLOTS1 - 1)); // far timer is cascaded again
+    timer_link(&ffrdp->wheel[slot], t);
+    t->expire = expire;
+    ffrdp->wheel_bits[slot / 32] |= 1u << (slot % 32);
+}
+
+static int32_t ffrdp_timer_next(FFRDPCONTEXT *ffrdp, uint32_t now) // ms until earliest armed timer, -1 if there is none
+{
+    FFRDP_TIMER *t;
+    int32_t i, slot, next = -1;
+    while ((i = bitmap_find(ffrdp->wheel_bits, ffrdp->wheel_tick & (FFRDP_WHEEL_SLOTS0 - 1), FFRDP_WHEEL_SLOTS0)) >= 0) { // level 0 slot gives exact tick
+        slot = (ffrdp->wheel_tick + i) & (FFRDP_WHEEL_SLOTS0 - 1);
+        if (ffrdp->wheel[slot]) { next = MAX(0, (int32_t)(ffrdp->wheel_tick + i - now)); break; }
+        ffrdp->wheel_bits[slot / 32] &= ~(1u << (slot % 32));
+    }
+    while ((i = bitmap_find(ffrdp->wheel_bits + FFRDP_WHEEL_SLOTS0 / 32, (ffrdp->wheel_tick >> FFRDP_WHEEL_BITS0) & (FFRDP_WHEEL_SLOTS1 - 1), FFRDP_WHEEL_SLOTS1)) >= 0) { // first level 1 slot holds the earliest far timer, it may fire before the level 0 one
+        slot = FFRDP_WHEEL_SLOTS0 + (((ffrdp->wheel_tick >> FFRDP_WHEEL_BITS0) + i) & (FFRDP_WHEEL_SLOTS1 - 1));
+        if (ffrdp->wheel[slot]) {
+            for (t=ffrdp->wheel[slot]; t; t=t->next) {
+                if (next < 0 || (int32_t)(t->expire - now) < next) next = MAX(0, (int32_t)(t->expire - now));
+            }
+            break;
+        }
+        ffrdp->wheel_bits[slot / 32] &= ~(1u << (slot % 32));
+    }
+    return next;
+}
+
+#ifdef CONFIG_ENABLE_IOURING
+static void ffrdp_iour_post_buf(FFRDPCONTEXT *ffrdp, int bid)
+{
+    struct io_uring_buf *buf = &ffrdp->iour_bufring->bufs[ffrdp->iour_buftail & (FFRDP_IOURING_NBUFS - 1)];
+    buf->addr = (uintptr_t)((uint8_t*)ffrdp->iour_bufnode[bid] + sizeof(FFRDP_FRAME_NODE));
+    buf->len  = IOURING_HEADROOM + 4 + FFRDP_MAX_MSS + 2;
+    buf->bid  = bid;
+    __atomic_store_n(&ffrdp->iour_bufring->tail, ++ffrdp->iour_buftail, __ATOMIC_RELEASE);
+}
+
+static struct io_uring_sqe* ffrdp_iour_get_sqe(FFRDPCONTEXT *ffrdp)
+{
+    uint32_t tail = *ffrdp->iour_sqtail, idx = tail & *ffrdp->iour_sqmask;
+    if (tail - __atomic_load_n(ffrdp->iour_sqhead, __ATOMIC_ACQUIRE) >= ffrdp->iour_sqentries) return NULL;
+    memset(&ffrdp->iour_sqes[idx], 0, sizeof(struct io_uring_sqe));
+    ffrdp->iour_sqarray[idx] = idx;
+    __atomic_store_n(ffrdp->iour_sqtail, tail + 1, __ATOMIC_RELEASE); // kernel only reads sqe in io_uring_enter
+    ffrdp->iour_tosubmit++;
+    return &ffrdp->iour_sqes[idx];
+}
+
+static int ffrdp_iour_enter(FFRDPCONTEXT *ffrdp, int mincomplete, int timeout) // timeout in us, -1 for infinite
+{
+    struct io_uring_getevents_arg arg;
+    struct __kernel_timespec      ts;
+    int ret;
+    memset(&arg, 0, sizeof(arg));
+    if (timeout >= 0) {
+        ts.tv_sec  = timeout / 1000000;
+        ts.tv_nsec = timeout % 1000000 * 1000;
+        arg.ts     = (uintptr_t)&ts;
+    }
+    ret = syscall(__NR_io_uring_enter, ffrdp->iour_fd, ffrdp->iour_tosubmit, mincomplete,
+                  IORING_ENTER_EXT_ARG | (mincomplete ? IORING_ENTER_GETEVENTS : 0), &arg, sizeof(arg));
+    if (ret > 0) ffrdp->iour_tosubmit -= ret;
+    return ret;
+}
+
+static void ffrdp_iour_arm_recv(FFRDPCONTEXT *ffrdp)
+{
+    struct io_uring_sqe *sqe = ffrdp_iour_get_sqe(ffrdp);
+    if (!sqe) return;
+    sqe->opcode    = IORING_OP_RECVMSG;
+    sqe->fd        = ffrdp->udp_fd;
+    sqe->addr      = (uintptr_t)&ffrdp->iour_rxmsg;
+    sqe->len       = 1;
+    sqe->ioprio    = IORING_RECV_MULTISHOT;
+    sqe->flags     = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = 0;
+    sqe->user_data = FFRDP_IOURING_UD_RECV;
+    ffrdp->iour_armed = 1;
+}
+
+static void ffrdp_iour_reap(FFRDPCONTEXT *ffrdp)
+{
+    uint32_t head = *ffrdp->iour_cqhead, tail = __atomic_load_n(ffrdp->iour_cqtail, __ATOMIC_ACQUIRE);
+    struct io_uring_cqe *cqe;
+    for (; head != tail; head++) {
+        cqe = &ffrdp->iour_cqes[head & *ffrdp->iour_cqmask];
+        if (cqe->user_data == FFRDP_IOURING_UD_RECV) {
+            if (cqe->res >= 0 && (cqe->flags & IORING_CQE_F_BUFFER)) {
+                ffrdp->iour_rxq[(ffrdp->iour_rxhead + ffrdp->iour_rxnum++) & (FFRDP_IOURING_NBUFS - 1)] = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+            }
+            if (!(cqe->flags & IORING_CQE_F_MORE)) { // multishot recvmsg terminated, it will be re-armed when needed
+                ffrdp->iour_armed = 0;
+                if (cqe->res == -EINVAL || cqe->res == -EOPNOTSUPP) ffrdp->flags &= ~FLAG_IOURING; // kernel doesn't support multishot recvmsg, fallback to recvmmsg/sendmmsg
+            }
+        } else if (cqe->user_data < FFRDP_TXQ_SIZE) {
+            ffrdp->iour_txres[cqe->user_data] = cqe->res;
+            ffrdp->iour_txpending--;
+        }
+    }
+    __atomic_store_n(ffrdp->iour_cqhead, head, __ATOMIC_RELEASE);
+}
+
+static int ffrdp_iour_sendmsgs(FFRDPCONTEXT *ffrdp, struct mmsghdr *msgs, int num) // submit only, return number of datagrams submitted or -1, results are reaped by ffrdp_iour_txdone
+{
+    struct io_uring_sqe *sqe, *last = NULL;
+    int i;
+    for (i=0; i<num && (sqe = ffrdp_iour_get_sqe(ffrdp)); i++, last=sqe) {
+        sqe->opcode    = IORING_OP_SENDMSG;
+        sqe->fd        = ffrdp->udp_fd;
+        sqe->addr      = (uintptr_t)&msgs[i].msg_hdr;
+        sqe->len       = 1;
+        sqe->msg_flags = MSG_DONTWAIT;
+        sqe->flags     = i < num - 1 ? IOSQE_IO_LINK : 0; // sends after a failed one are cancelled, just like sendmmsg
+        sqe->user_data = i;
+        ffrdp->iour_txres[i] = -ECANCELED;
+    }
+    if (i < num && last) last->flags = 0; // submission queue is full, break the link at last queued sqe
+    if (i == 0) { errno = EAGAIN; return -1; } // submission queue is full
+    ffrdp->iour_txpending = ffrdp->iour_txmsgs = i;
+    ffrdp->counter_send_syscall++;
+    ffrdp_iour_enter(ffrdp, 0, -1); // MSG_DONTWAIT sends normally complete during submission, sqes left by a failed enter go with the next one
+    ffrdp_iour_reap(ffrdp);
+    return i;
+}
+
+static int ffrdp_iour_recv_frame(FFRDPCONTEXT *ffrdp, FFRDP_FRAME_NODE **node, struct sockaddr_in *srcaddr)
+{
+    struct io_uring_recvmsg_out *out;
+    int bid;
+    if (ffrdp->iour_rxout >= 0) { // give buffer of last frame back to kernel, a new one if last frame was handed off to recv_ring
+        if (*node == NULL) ffrdp->iour_bufnode[ffrdp->iour_rxout] = NULL;
+        ffrdp->iour_bufmiss += !ffrdp->iour_bufnode[ffrdp->iour_rxout];
+        if (ffrdp->iour_bufnode[ffrdp->iour_rxout]) ffrdp_iour_post_buf(ffrdp, ffrdp->iour_rxout);
+        ffrdp->iour_rxout = -1;
+    }
+    for (bid=0; bid<FFRDP_IOURING_NBUFS && ffrdp->iour_bufmiss > 0; bid++) { // else the buffer ring shrinks for good
+        if (ffrdp->iour_bufnode[bid]) continue;
+        if (!(ffrdp->iour_bufnode[bid] = frame_node_new(&ffrdp->pool, FFRDP_FRAME_TYPE_FEC2, FFRDP_MAX_MSS + IOURING_HEADROOM))) break;
+        ffrdp_iour_post_buf(ffrdp, bid); ffrdp->iour_bufmiss--;
+    }
+    for (;;) {
+        if (ffrdp->iour_rxnum == 0) {
+            if (!ffrdp->iour_armed) {
+                ffrdp_iour_arm_recv(ffrdp);
+                ffrdp->counter_recv_syscall++;
+                ffrdp_iour_enter(ffrdp, 0, -1);
+            }
+            ffrdp_iour_reap(ffrdp);
+            if (ffrdp->iour_rxnum == 0) return -1;
+        }
+        bid = ffrdp->iour_rxq[ffrdp->iour_rxhead++ & (FFRDP_IOURING_NBUFS - 1)]; ffrdp->iour_rxnum--;
+        out = (struct io_uring_recvmsg_out*)((uint8_t*)ffrdp->iour_bufnode[bid] + sizeof(FFRDP_FRAME_NODE));
+        if (out->payloadlen > 0 && !(out->flags & MSG_TRUNC)) break;
+        ffrdp_iour_post_buf(ffrdp, bid); // drop empty or truncated datagram
+    }
+    *node = ffrdp->iour_bufnode[bid];
+    (*node)->data = (uint8_t*)out + IOURING_HEADROOM;
+    (*node)->size = 4 + FFRDP_MAX_MSS + 2;
+    memcpy(srcaddr, out + 1, sizeof(struct sockaddr_in));
+    ffrdp->iour_rxout = bid;
+    ffrdp->counter_recv_packet++;
+    return out->payloadlen;
+}
+
+static int ffrdp_iour_wait(FFRDPCONTEXT *ffrdp, int timeout) // wait until a datagram arrives or timeout (in us)
+{
+    int pending;
+    ffrdp_iour_reap(ffrdp);
+    if (ffrdp->iour_rxnum > 0) return 0;
+    if (!ffrdp->iour_armed) ffrdp_iour_arm_recv(ffrdp);
+    do { // a late send completion wakes us up too, wait again for datagrams
+        pending = ffrdp->iour_txpending;
+        ffrdp->counter_recv_syscall++;
+        ffrdp_iour_enter(ffrdp, 1, timeout);
+        ffrdp_iour_reap(ffrdp);
+    } while (ffrdp->iour_rxnum == 0 && ffrdp->iour_txpending < pending);
+    return ffrdp->iour_rxnum > 0 ? 0 : -1;
+}
+
+static void ffrdp_iour_free(FFRDPCONTEXT *ffrdp)
+{
+    struct io_uring_sqe *sqe;
+    int i;
+    if (ffrdp->iour_fd < 0) return;
+    for (i=0; i<100 && ffrdp->iour_txpending > 0; i++) { ffrdp_iour_enter(ffrdp, 1, 1000); ffrdp_iour_reap(ffrdp); } // kernel may still read tx queue
+    if (ffrdp->iour_armed && (sqe = ffrdp_iour_get_sqe(ffrdp))) { // cancel multishot recvmsg before freeing its buffers
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr   = FFRDP_IOURING_UD_RECV;
+        sqe->user_data = FFRDP_IOURING_UD_RECV - 1;
+        for (i=0; i<100 && ffrdp->iour_armed; i++) { ffrdp_iour_enter(ffrdp, 1, 1000); ffrdp_iour_reap(ffrdp); }
+    }
+    close(ffrdp->iour_fd);
+    if (ffrdp->iour_ring   ) munmap(ffrdp->iour_ring, ffrdp->iour_ringsize);
+    if (ffrdp->iour_sqes   ) munmap(ffrdp->iour_sqes, ffrdp->iour_sqentries * sizeof(struct io_uring_sqe));
+    if (ffrdp->iour_bufring) munmap(ffrdp->iour_bufring, FFRDP_IOURING_NBUFS * sizeof(struct io_uring_buf));
+    for (i=0; i<FFRDP_IOURING_NBUFS; i++) free(ffrdp->iour_bufnode[i]);
+    ffrdp->iour_fd = -1;
+}
+
+static int ffrdp_iour_init(FFRDPCONTEXT *ffrdp)
+{
+    struct io_uring_params  params;
+    struct io_uring_buf_reg reg;
+    uint8_t *ring, *bufring;
+    int i;
+    memset(&params, 0, sizeof(params));
+    ffrdp->iour_rxout = -1;
+    if ((ffrdp->iour_fd = syscall(__NR_io_uring_setup, FFRDP_IOURING_SQSIZE, &params)) < 0) return -1;
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG)) return -1;
+    ffrdp->iour_ringsize  = MAX(params.sq_off.array + params.sq_entries * sizeof(uint32_t), params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe));
+    ffrdp->iour_sqentries = params.sq_entries;
+    ring = mmap(NULL, ffrdp->iour_ringsize, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, ffrdp->iour_fd, IORING_OFF_SQ_RING);
+    if (ring == MAP_FAILED) return -1;
+    ffrdp->iour_ring    = ring;
+    ffrdp->iour_sqhead  = (uint32_t*)(ring + params.sq_off.head);
+    ffrdp->iour_sqtail  = (uint32_t*)(ring + params.sq_off.tail);
+    ffrdp->iour_sqmask  = (uint32_t*)(ring + params.sq_off.ring_mask);
+    ffrdp->iour_sqarray = (uint32_t*)(ring + params.sq_off.array);
+    ffrdp->iour_cqhead  = (uint32_t*)(ring + params.cq_off.head);
+    ffrdp->iour_cqtail  = (uint32_t*)(ring + params.cq_off.tail);
+    ffrdp->iour_cqmask  = (uint32_t*)(ring + params.cq_off.ring_mask);
+    ffrdp->iour_cqes    = (struct io_uring_cqe*)(ring + params.cq_off.cqes);
+    ring = mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe), PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, ffrdp->iour_fd, IORING_OFF_SQES);
+    if (ring == MAP_FAILED) return -1;
+    ffrdp->iour_sqes = (struct io_uring_sqe*)ring;
+
+    bufring = mmap(NULL, FFRDP_IOURING_NBUFS * sizeof(struct io_uring_buf), PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (bufring == MAP_FAILED) return -1;
+    ffrdp->iour_bufring = (struct io_uring_buf_ring*)bufring;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr    = (uintptr_t)bufring;
+    reg.ring_entries = FFRDP_IOURING_NBUFS;
+    reg.bgid         = 0;
+    if (syscall(__NR_io_uring_register, ffrdp->iour_fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) return -1;
+    for (i=0; i<FFRDP_IOURING_NBUFS; i++) {
+        if (!(ffrdp->iour_bufnode[i] = frame_node_new(&ffrdp->pool, FFRDP_FRAME_TYPE_FEC2, FFRDP_MAX_MSS + IOURING_HEADROOM))) return -1;
+        ffrdp_iour_post_buf(ffrdp, i);
+    }
+    ffrdp->iour_rxmsg.msg_namelen = sizeof(struct sockaddr_in);
+    return 0;
+}
+#endif
+
+static int ffrdp_sleep(FFRDPCONTEXT *ffrdp, int flag)
+{
+    if (ffrdp->flags & FLAG_FLUSH) { ffrdp->flags &= ~FLAG_FLUSH; return 0; }
+    if (ffrdp->flags & FLAG_EVLOOP) return 0; // ffrdp_loop already waited for us
+#ifdef CONFIG_ENABLE_IOURING
+    if (ffrdp->flags & FLAG_IOURING) return ffrdp_iour_wait(ffrdp, flag ? FFRDP_SELECT_TIMEOUT : FFRDP_USLEEP_TIMEOUT) == 0 || !flag ? 0 : -1; // wakeup as soon as a datagram arrives
+#endif
+    if (flag) {
+        struct timeval tv;
+        fd_set  rs;
+        FD_ZERO(&rs);
+        FD_SET(ffrdp->udp_fd, &rs);
+        tv.tv_sec  = 0;
+        tv.tv_usec = FFRDP_SELECT_TIMEOUT;
+        if (select((int)ffrdp->udp_fd + 1, &rs, NULL, NULL, &tv) <= 0) return -1;
+    } else usleep(FFRDP_USLEEP_TIMEOUT);
+    return 0;
+}
+
+#ifdef CONFIG_ENABLE_MMSG
+static int ffrdp_rxmmsg_refill(FFRDPCONTEXT *ffrdp) // re-post receive buffers and receive next batch
+{
+    int bufsize = 4 + FFRDP_MAX_MSS + 2, i, n;
+#ifdef CONFIG_ENABLE_GRO
+    if (ffrdp->flags & FLAG_UDP_GRO) bufsize = FFRDP_GRO_BUFSIZE; // gro buffers are never handed off, segments are copied out of them
+#endif
+    for (i=0; i<FFRDP_MMSG_BATCH; i++) {
+        if (!ffrdp->rxmmsg_node[i] && !(ffrdp->rxmmsg_node[i] = frame_node_new(&ffrdp->pool, FFRDP_FRAME_TYPE_FEC2, bufsize - 6))) break;
+        ffrdp->rxmmsg_iov[i].iov_base = ffrdp->rxmmsg_node[i]->data;
+        ffrdp->rxmmsg_iov[i].iov_len  = bufsize;
+        memset(&ffrdp->rxmmsg_hdr[i], 0, sizeof(struct mmsghdr));
+        if (!(ffrdp->flags & FLAG_UDP_CONNECTED)) { // source address is not needed for connected socket
+            ffrdp->rxmmsg_hdr[i].msg_hdr.msg_name    = &ffrdp->rxmmsg_addr[i];
+            ffrdp->rxmmsg_hdr[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+        }
+        ffrdp->rxmmsg_hdr[i].msg_hdr.msg_iov     = &ffrdp->rxmmsg_iov[i];
+        ffrdp->rxmmsg_hdr[i].msg_hdr.msg_iovlen  = 1;
+#ifdef CONFIG_ENABLE_GRO
+        if (ffrdp->flags & FLAG_UDP_GRO) {
+            ffrdp->rxmmsg_hdr[i].msg_hdr.msg_control    = ffrdp->rxmmsg_ctl[i];
+            ffrdp->rxmmsg_hdr[i].msg_hdr.msg_controllen = sizeof(ffrdp->rxmmsg_ctl[i]);
+        }
+#endif
+    }
+    ffrdp->rxmmsg_idx = ffrdp->rxmmsg_num = 0;
+    if (i == 0) return -1;
+    ffrdp->counter_recv_syscall++;
+    if ((n = recvmmsg(ffrdp->udp_fd, ffrdp->rxmmsg_hdr, i, MSG_DONTWAIT, NULL)) <= 0) return -1;
+    return (ffrdp->rxmmsg_num = n);
+}
+
+#ifdef CONFIG_ENABLE_GRO
+static int ffrdp_recv_gro_frame(FFRDPCONTEXT *ffrdp, FFRDP_FRAME_NODE **node, struct sockaddr_in *srcaddr) // segment is copied to a pooled node, it is aligned and doesn't pin the 64KB gro buffer in recv_ring
+{
+    struct msghdr  *msg;
+    struct cmsghdr *cmsg;
+    int size;
+    if (ffrdp->rxgro_out && *node == NULL) ffrdp->rxgro_node = NULL; // last segment was handed off to recv_ring
+    ffrdp->rxgro_out = 0;
+    for (;;) {
+        if (ffrdp->rxmmsg_idx == ffrdp->rxmmsg_num) {
+            if (ffrdp_rxmmsg_refill(ffrdp) <= 0) return -1;
+            ffrdp->rxgro_off = 0;
+        }
+        msg = &ffrdp->rxmmsg_hdr[ffrdp->rxmmsg_idx].msg_hdr;
+        if (ffrdp->rxgro_off == 0) { // get segment size of the coalesced datagram
+            ffrdp->rxgro_seg = ffrdp->rxmmsg_hdr[ffrdp->rxmmsg_idx].msg_len;
+            for (cmsg=CMSG_FIRSTHDR(msg); cmsg; cmsg=CMSG_NXTHDR(msg, cmsg)) {
+                if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) memcpy(&ffrdp->rxgro_seg, CMSG_DATA(cmsg), sizeof(int));
             }
         }
-        node->next = *head;
-        node->next->prev = node;
-        *head = node;
+        if (ffrdp->rxgro_off >= (int)ffrdp->rxmmsg_hdr[ffrdp->rxmmsg_idx].msg_len) { ffrdp->rxmmsg_idx++; ffrdp->rxgro_off = 0; continue; }
+        size = MIN(ffrdp->rxgro_seg, (int)ffrdp->rxmmsg_hdr[ffrdp->rxmmsg_idx].msg_len - ffrdp->rxgro_off);
+        ffrdp->rxgro_off += size;
+        if (size <= 4 + FFRDP_MAX_MSS + 2) break; // segment larger than any frame is dropped
+    }
+    if (!ffrdp->rxgro_node && !(ffrdp->rxgro_node = frame_node_new(&ffrdp->pool, FFRDP_FRAME_TYPE_FEC2, FFRDP_MAX_MSS))) return -1;
+    memcpy(ffrdp->rxgro_node->data, ffrdp->rxmmsg_node[ffrdp->rxmmsg_idx]->data + ffrdp->rxgro_off - size, size);
+    ffrdp->rxgro_node->size = size;
+    ffrdp->rxgro_out = 1;
+    ffrdp->counter_recv_packet++;
+    *node = ffrdp->rxgro_node;
+    memcpy(srcaddr, &ffrdp->rxmmsg_addr[ffrdp->rxmmsg_idx], sizeof(struct sockaddr_in));
+    return size;
+}
+#endif
+
+static int ffrdp_recv_frame(FFRDPCONTEXT *ffrdp, FFRDP_FRAME_NODE **node, struct sockaddr_in *srcaddr)
+{
+    int i;
+#ifdef CONFIG_ENABLE_IOURING
+    if (ffrdp->flags & FLAG_IOURING) return ffrdp_iour_recv_frame(ffrdp, node, srcaddr);
+#endif
+#ifdef CONFIG_ENABLE_GRO
+    if (ffrdp->flags & FLAG_UDP_GRO) return ffrdp_recv_gro_frame(ffrdp, node, srcaddr);
+#endif
+    if (ffrdp->rxmmsg_idx > 0 && *node == NULL) ffrdp->rxmmsg_node[ffrdp->rxmmsg_idx - 1] = NULL; // last node was handed off to recv_ring
+    do {
+        if (ffrdp->rxmmsg_idx == ffrdp->rxmmsg_num && ffrdp_rxmmsg_refill(ffrdp) <= 0) return -1; // batch consumed
+        i = ffrdp->rxmmsg_idx++;
+    } while (ffrdp->rxmmsg_hdr[i].msg_len == 0); // skip empty datagram
+    *node = ffrdp->rxmmsg_node[i];
+    (*node)->size = 4 + FFRDP_MAX_MSS + 2;
+    ffrdp->counter_recv_packet++;
+    memcpy(srcaddr, &ffrdp->rxmmsg_addr[i], sizeof(struct sockaddr_in));
+    return ffrdp->rxmmsg_hdr[i].msg_len;
+}
+#else
+static int ffrdp_recv_frame(FFRDPCONTEXT *ffrdp, FFRDP_FRAME_NODE **node, struct sockaddr_in *srcaddr)
+{
+    int32_t addrlen = sizeof(struct sockaddr_in), ret;
+    if (*node == NULL && ffrdp->rxnode_out) ffrdp->rxnode = NULL; // last node was handed off to recv_ring
+    ffrdp->rxnode_out = 0;
+    if (!ffrdp->rxnode && !(ffrdp->rxnode = frame_node_new(&ffrdp->pool, FFRDP_FRAME_TYPE_FEC2, FFRDP_MAX_MSS))) return -1;
+    *node = ffrdp->rxnode; // ack and query frames are parsed in place, the node stays posted
+    ffrdp->counter_recv_syscall++;
+    if (ffrdp->flags & FLAG_UDP_CONNECTED) ret = recv(ffrdp->udp_fd, (*node)->data, 4 + FFRDP_MAX_MSS + 2, 0);
+    else ret = recvfrom(ffrdp->udp_fd, (*node)->data, 4 + FFRDP_MAX_MSS + 2, 0, (struct sockaddr*)srcaddr, &addrlen);
+    if (ret > 0) { ffrdp->counter_recv_packet++; ffrdp->rxnode_out = 1; }
+    return ret;
+}
+#endif
+
+static int ffrdp_recv_next(FFRDPCONTEXT *ffrdp, FFRDP_FRAME_NODE **node, struct sockaddr_in *srcaddr) // datagrams handed over by ffrdp_loop listener first, then those of socket
+{
+    if (ffrdp->rxpend_out) { // last one came from rxpend, free it if it wasn't handed off to recv_ring
+        if (*node) frame_node_free(*node);
+        *node = NULL; ffrdp->rxpend_out = 0;
+    }
+    if (!ffrdp->rxpend) return ffrdp_recv_frame(ffrdp, node, srcaddr);
+    *node = ffrdp->rxpend; ffrdp->rxpend = (*node)->next; (*node)->next = NULL;
+    memcpy(srcaddr, &ffrdp->client_addr, sizeof(struct sockaddr_in));
+    ffrdp->rxpend_out = 1;
+    ffrdp->counter_recv_packet++;
+    return (*node)->size;
+}
+
+#define CC_FLIGHT(ffrdp) ((ffrdp)->wait_snd - ((ffrdp)->send_seq - (ffrdp)->send_next)) // frames sent and not acked
+enum { CC_RECOVERY_NONE, CC_RECOVERY_FAST, CC_RECOVERY_LOSS };
+
+static void cc_clamp(FFRDPCONTEXT *ffrdp)
+{
+    ffrdp->cwnd = MIN(ffrdp->cwnd, FFRDP_MAX_CWND_SIZE);
+    ffrdp->cwnd = MAX(ffrdp->cwnd, FFRDP_MIN_CWND_SIZE);
+}
+
+static int cc_recovery(FFRDPCONTEXT *ffrdp) // current recovery state, leave it once all frames sent before it started are acked
+{
+    if (ffrdp->cc_state.recovery && (int32_t)(ffrdp->send_head - ffrdp->cc_state.recover) >= 0) ffrdp->cc_state.recovery = CC_RECOVERY_NONE;
+    return ffrdp->cc_state.recovery;
+}
+
+static void cc_enter_recovery(FFRDPCONTEXT *ffrdp, int state)
+{
+    ffrdp->cc_state.recovery = state;
+    ffrdp->cc_state.recover  = ffrdp->send_next;
+    ffrdp->cc_state.cnt      = 0;
+}
+
+static uint32_t cc_cwnd(FFRDPCONTEXT *ffrdp)
+{
+    return ffrdp->cwnd;
+}
+
+static void cc_on_send(FFRDPCONTEXT *ffrdp, FFRDP_FRAME_NODE *frame) // restart after idle (rfc 5681 4.1), cwnd of an old ack clock isn't sent as one burst
+{
+    (void)frame;
+    if (CC_FLIGHT(ffrdp) || ffrdp->rtts == (uint32_t)-1 || (int32_t)(get_tick_count() - ffrdp->tick_recv_ack) <= (int32_t)ffrdp->rto) return;
+    ffrdp->cwnd = MIN(ffrdp->cwnd, FFRDP_DEF_CWND_SIZE);
+}
+
+static uint64_t cc_pacing_rate(FFRDPCONTEXT *ffrdp) // cwnd per srtt, 2x (slow start) or 1.25x
+{
+    if (ffrdp->rtts == (uint32_t)-1) return 0; // no rtt sample yet
+    return (uint64_t)ffrdp->cwnd * (4 + ffrdp->smss) * 1000 * (ffrdp->cwnd < ffrdp->ssthresh ? 8 : 5) / (4 * MAX(ffrdp->rtts, 1));
+}
+
+static void newreno_init(FFRDPCONTEXT *ffrdp)
+{
+    memset(&ffrdp->cc_state, 0, sizeof(ffrdp->cc_state));
+    ffrdp->cc_state.min_rtt = (uint32_t)-1;
+    ffrdp->cwnd     = FFRDP_DEF_CWND_SIZE;
+    ffrdp->ssthresh = FFRDP_MAX_CWND_SIZE; // slow start until first loss
+}
+
+static void newreno_on_ack(FFRDPCONTEXT *ffrdp, uint32_t acked, uint32_t rttm)
+{
+    (void)rttm;
+    if (cc_recovery(ffrdp) == CC_RECOVERY_FAST) return; // cwnd is held at ssthresh until recovery ends
+    if (ffrdp->cwnd < ffrdp->ssthresh) ffrdp->cwnd += acked; // slow start, one frame per acked frame
+    else if ((ffrdp->cc_state.cnt += acked) >= ffrdp->cwnd) { // congestion avoidance, one frame per rtt
+        ffrdp->cwnd += ffrdp->cc_state.cnt / ffrdp->cwnd;
+        ffrdp->cc_state.cnt = 0;
+    }
+    cc_clamp(ffrdp);
+}
+
+static void newreno_on_loss(FFRDPCONTEXT *ffrdp)
+{
+    if (cc_recovery(ffrdp)) return; // one reduction per window
+    ffrdp->ssthresh = MAX(CC_FLIGHT(ffrdp) / 2, 2);
+    ffrdp->cwnd     = ffrdp->ssthresh;
+    cc_enter_recovery(ffrdp, CC_RECOVERY_FAST);
+    cc_clamp(ffrdp);
+}
+
+static void newreno_on_rto(FFRDPCONTEXT *ffrdp)
+{
+    if (!cc_recovery(ffrdp)) ffrdp->ssthresh = MAX(CC_FLIGHT(ffrdp) / 2, 2); // ssthresh is not lowered again by frames lost in the same window
+    ffrdp->cwnd = FFRDP_MIN_CWND_SIZE;
+    cc_enter_recovery(ffrdp, CC_RECOVERY_LOSS);
+}
+
+#define CUBIC_BETA       717 // 0.7 in 1/1024
+#define CUBIC_C          410 // 0.4 in 1/1024
+#define CUBIC_ALPHA      542 // 3 * (1 - beta) / (1 + beta) in 1/1024, reno friendly increase per rtt
+#define HYSTART_MIN_SAMPLES 8
+#define HYSTART_CSS_ROUNDS  5
+#define HYSTART_CSS_DIVISOR 4
+static uint32_t cubic_root(uint64_t a)
+{
+    uint64_t x = 1, y;
+    while (x * x * x < a) x <<= 1;
+    do { y = x; x = (2 * x + a / (x * x)) / 3; } while (x < y); // newton iteration from above
+    return (uint32_t)y;
+}
+
+static void cubic_hystart_reset(FFRDPCONTEXT *ffrdp)
+{
+    ffrdp->cc_state.u.cubic.round_end = ffrdp->send_next;
+    ffrdp->cc_state.u.cubic.rtt_cur   = ffrdp->cc_state.u.cubic.rtt_last = (uint32_t)-1;
+    ffrdp->cc_state.u.cubic.rtt_cnt   = ffrdp->cc_state.u.cubic.css = 0;
+}
+
+static void cubic_init(FFRDPCONTEXT *ffrdp)
+{
+    newreno_init(ffrdp);
+    cubic_hystart_reset(ffrdp);
+}
+
+static void cubic_slow_start(FFRDPCONTEXT *ffrdp, uint32_t acked, uint32_t rttm) // hystart++ (rfc 9406)
+{
+    FFRDP_CC_STATE *cc = &ffrdp->cc_state;
+    uint32_t thresh;
+    if ((int32_t)(ffrdp->send_head - cc->u.cubic.round_end) >= 0) { // round ends, next round ends when frames sent so far are acked
+        cc->u.cubic.round_end = ffrdp->send_next;
+        cc->u.cubic.rtt_last  = cc->u.cubic.rtt_cur;
+        cc->u.cubic.rtt_cur   = (uint32_t)-1;
+        cc->u.cubic.rtt_cnt   = 0;
+        if (cc->u.cubic.css && ++cc->u.cubic.css_rounds >= HYSTART_CSS_ROUNDS) { // delay increase persists, leave slow start
+            ffrdp->ssthresh = ffrdp->cwnd; cc->u.cubic.css = 0;
+            return;
+        }
+    }
+    if (rttm != (uint32_t)-1) { cc->u.cubic.rtt_cur = MIN(cc->u.cubic.rtt_cur, rttm); cc->u.cubic.rtt_cnt++; }
+    if (cc->u.cubic.rtt_cnt >= HYSTART_MIN_SAMPLES && cc->u.cubic.rtt_cur != (uint32_t)-1 && cc->u.cubic.rtt_last != (uint32_t)-1) {
+        if (!cc->u.cubic.css) {
+            thresh = MAX(4, MIN(cc->u.cubic.rtt_last / 8, 16));
+            if (cc->u.cubic.rtt_cur >= cc->u.cubic.rtt_last + thresh) { cc->u.cubic.css = 1; cc->u.cubic.css_base = cc->u.cubic.rtt_cur; cc->u.cubic.css_rounds = 0; }
+        } else if (cc->u.cubic.rtt_cur < cc->u.cubic.css_base) cc->u.cubic.css = 0; // delay increase was spurious, back to slow start
+    }
+    if (cc->u.cubic.css) { cc->cnt += acked; ffrdp->cwnd += cc->cnt / HYSTART_CSS_DIVISOR; cc->cnt %= HYSTART_CSS_DIVISOR; }
+    else ffrdp->cwnd += acked;
+}
+
+static void cubic_on_ack(FFRDPCONTEXT *ffrdp, uint32_t acked, uint32_t rttm) // cubic (rfc 9438)
+{
+    FFRDP_CC_STATE *cc = &ffrdp->cc_state;
+    uint32_t now = get_tick_count(), need;
+    int64_t  t, target, cwnd = (int64_t)ffrdp->cwnd << 10;
+    if (rttm != (uint32_t)-1) cc->min_rtt = MIN(cc->min_rtt, rttm);
+    if (cc_recovery(ffrdp) == CC_RECOVERY_FAST) return;
+    if (ffrdp->cwnd < ffrdp->ssthresh) { cubic_slow_start(ffrdp, acked, rttm); cc_clamp(ffrdp); return; }
+    if (!cc->u.cubic.epoch) { // first ack of congestion avoidance epoch
+        cc->u.cubic.epoch = now ? now : 1;
+        cc->u.cubic.west  = ffrdp->cwnd << 10;
+        cc->cnt           = 0;
+        if (ffrdp->cwnd < cc->u.cubic.wmax) {
+            cc->u.cubic.k      = cubic_root((uint64_t)(cc->u.cubic.wmax - ffrdp->cwnd) * 1000000000 * 1024 / CUBIC_C); // ms
+            cc->u.cubic.origin = cc->u.cubic.wmax;
+        } else {
+            cc->u.cubic.k      = 0;
+            cc->u.cubic.origin = ffrdp->cwnd;
+        }
+    }
+    t = (int32_t)(now - cc->u.cubic.epoch) + (cc->min_rtt == (uint32_t)-1 ? 0 : cc->min_rtt) - (int64_t)cc->u.cubic.k; // window one rtt ahead
+    t = MAX(-60000, MIN(t, 60000));
+    target = ((int64_t)cc->u.cubic.origin << 10) + t * t * t * CUBIC_C / 1000000000; // origin + c * t^3, in 1/1024 frames
+    need   = target > cwnd ? (uint32_t)MAX(1, cwnd / (target - cwnd)) : 100 * ffrdp->cwnd; // acked frames per one frame increase
+    cc->u.cubic.west += acked * CUBIC_ALPHA / ffrdp->cwnd; // reno friendly region
+    if ((int64_t)cc->u.cubic.west > cwnd) need = MIN(need, (uint32_t)MAX(1, cwnd / ((int64_t)cc->u.cubic.west - cwnd)));
+    if ((cc->cnt += acked) >= need) { ffrdp->cwnd += cc->cnt / need; cc->cnt %= need; }
+    cc_clamp(ffrdp);
+}
+
+static void cubic_on_send(FFRDPCONTEXT *ffrdp, FFRDP_FRAME_NODE *frame)
+{
+    int32_t idle = (int32_t)(get_tick_count() - ffrdp->tick_recv_ack);
+    if (!CC_FLIGHT(ffrdp) && ffrdp->cc_state.u.cubic.epoch && idle > 0) ffrdp->cc_state.u.cubic.epoch += idle; // idle time doesn't grow cubic window
+    cc_on_send(ffrdp, frame);
+}
+
+static void cubic_reduce(FFRDPCONTEXT *ffrdp)
+{
+    FFRDP_CC_STATE *cc = &ffrdp->cc_state;
+    cc->u.cubic.wmax  = ffrdp->cwnd < cc->u.cubic.wmax ? ffrdp->cwnd * (1024 + CUBIC_BETA) / 2048 : ffrdp->cwnd; // fast convergence
+    cc->u.cubic.epoch = 0;
+    ffrdp->ssthresh   = MAX(ffrdp->cwnd * CUBIC_BETA / 1024, 2);
+    cubic_hystart_reset(ffrdp);
+}
+
+static void cubic_on_loss(FFRDPCONTEXT *ffrdp)
+{
+    if (cc_recovery(ffrdp)) return;
+    cubic_reduce(ffrdp);
+    ffrdp->cwnd = ffrdp->ssthresh;
+    cc_enter_recovery(ffrdp, CC_RECOVERY_FAST);
+    cc_clamp(ffrdp);
+}
+
+static void cubic_on_rto(FFRDPCONTEXT *ffrdp)
+{
+    if (!cc_recovery(ffrdp)) cubic_reduce(ffrdp);
+    ffrdp->cwnd = FFRDP_MIN_CWND_SIZE;
+    cc_enter_recovery(ffrdp, CC_RECOVERY_LOSS);
+}
+
+#define BBR_UNIT          256   // gains are in 1/256
+#define BBR_HIGH_GAIN     739   // 2/ln2, startup doubles sending rate every round
+#define BBR_DRAIN_GAIN    88    // 1/BBR_HIGH_GAIN, drain queue built in startup
+#define BBR_CWND_GAIN     512
+#define BBR_BW_ROUNDS     10    // must match size of bw in FFRDP_CC_STATE
+#define BBR_MIN_RTT_WIN   10000 // ms, probe rtt when min rtt isn't refreshed in this time
+#define BBR_PROBE_RTT_TIME 200  // ms
+#define BBR_MIN_CWND      4
+enum { BBR_STARTUP, BBR_DRAIN, BBR_PROBE_BW, BBR_PROBE_RTT };
+static const uint16_t g_bbr_cycle[8] = { 320, 192, 256, 256, 256, 256, 256, 256 }; // probe bw pacing gains, probe up then drain then cruise
+
+static uint32_t bbr_bdp(FFRDPCONTEXT *ffrdp, uint32_t gain) // frames of estimated bandwidth-delay product
+{
+    if (!ffrdp->cc_state.u.bbr.btlbw || ffrdp->cc_state.u.bbr.min_rtt == (uint32_t)-1) return FFRDP_DEF_CWND_SIZE;
+    return (uint32_t)(((uint64_t)ffrdp->cc_state.u.bbr.btlbw * ffrdp->cc_state.u.bbr.min_rtt / 1000000 * gain / BBR_UNIT + ffrdp->smss + 3) / (ffrdp->smss + 4));
+}
+
+static void bbr_set_mode(FFRDPCONTEXT *ffrdp, uint32_t mode)
+{
+    static const uint16_t pacing_gain[] = { BBR_HIGH_GAIN, BBR_DRAIN_GAIN, 0, BBR_UNIT };
+    static const uint16_t cwnd_gain  [] = { BBR_HIGH_GAIN, BBR_HIGH_GAIN, BBR_CWND_GAIN, BBR_UNIT };
+    ffrdp->cc_state.u.bbr.mode        = mode;
+    ffrdp->cc_state.u.bbr.pacing_gain = pacing_gain[mode];
+    ffrdp->cc_state.u.bbr.cwnd_gain   = cwnd_gain  [mode];
+    if (mode == BBR_PROBE_BW) { // start at a random cruise phase
+        ffrdp->cc_state.u.bbr.cycle_idx   = 2 + rand() % 6;
+        ffrdp->cc_state.u.bbr.cycle_tick  = get_tick_count();
+        ffrdp->cc_state.u.bbr.pacing_gain = g_bbr_cycle[ffrdp->cc_state.u.bbr.cycle_idx];
+    }
+}
+
+static void bbr_init(FFRDPCONTEXT *ffrdp)
+{
+    newreno_init(ffrdp);
+    ffrdp->cc_state.u.bbr.min_rtt      = (uint32_t)-1;
+    ffrdp->cc_state.u.bbr.min_rtt_tick = get_tick_count();
+    ffrdp->cc_state.u.bbr.round_end    = ffrdp->send_next;
+    bbr_set_mode(ffrdp, BBR_STARTUP);
+}
+
+static void bbr_update_model(FFRDPCONTEXT *ffrdp, uint32_t now)
+{
+    FFRDP_CC_STATE *cc = &ffrdp->cc_state;
+    int expired = (int32_t)(now - cc->u.bbr.min_rtt_tick) > BBR_MIN_RTT_WIN, i;
+    if ((cc->u.bbr.round_start = (int32_t)(ffrdp->send_head - cc->u.bbr.round_end) >= 0)) { // new round
+        cc->u.bbr.round_end = ffrdp->send_next;
+        cc->u.bbr.bw[++cc->u.bbr.round % BBR_BW_ROUNDS] = 0;
+    }
+    if (ffrdp->rs_rate && (!ffrdp->rs_applimited || ffrdp->rs_rate >= cc->u.bbr.btlbw)) { // app limited sample only raises the estimate
+        cc->u.bbr.bw[cc->u.bbr.round % BBR_BW_ROUNDS] = MAX(cc->u.bbr.bw[cc->u.bbr.round % BBR_BW_ROUNDS], ffrdp->rs_rate);
+    }
+    for (cc->u.bbr.btlbw=0,i=0; i<BBR_BW_ROUNDS; i++) cc->u.bbr.btlbw = MAX(cc->u.bbr.btlbw, cc->u.bbr.bw[i]);
+    if (ffrdp->rs_rtt != (uint32_t)-1 && (ffrdp->rs_rtt <= cc->u.bbr.min_rtt || expired)) {
+        cc->u.bbr.min_rtt = ffrdp->rs_rtt; cc->u.bbr.min_rtt_tick = now;
+    }
+
+    if (cc->u.bbr.mode == BBR_STARTUP && cc->u.bbr.round_start && ffrdp->rs_rate && !ffrdp->rs_applimited) {
+        if (cc->u.bbr.btlbw >= (uint64_t)cc->u.bbr.full_bw * 5 / 4) { cc->u.bbr.full_bw = cc->u.bbr.btlbw; cc->u.bbr.full_bw_cnt = 0; }
+        else if (++cc->u.bbr.full_bw_cnt >= 3) { cc->u.bbr.filled = 1; bbr_set_mode(ffrdp, BBR_DRAIN); }
+    }
+    if (cc->u.bbr.mode == BBR_DRAIN && CC_FLIGHT(ffrdp) <= bbr_bdp(ffrdp, BBR_UNIT)) bbr_set_mode(ffrdp, BBR_PROBE_BW);
+    if (cc->u.bbr.mode == BBR_PROBE_BW) { // each phase lasts one min rtt, probing up lasts until queue is built or loss, draining stops once queue is gone
+        int full = (int32_t)(now - cc->u.bbr.cycle_tick) > (int32_t)(cc->u.bbr.min_rtt / 1000), gain = g_bbr_cycle[cc->u.bbr.cycle_idx];
+        if (  (gain > BBR_UNIT && full && (cc->recovery || CC_FLIGHT(ffrdp) >= bbr_bdp(ffrdp, gain)))
+           || (gain < BBR_UNIT && (full || CC_FLIGHT(ffrdp) <= bbr_bdp(ffrdp, BBR_UNIT)))
+           || (gain== BBR_UNIT && full)) {
+            cc->u.bbr.cycle_idx   = (cc->u.bbr.cycle_idx + 1) % 8;
+            cc->u.bbr.cycle_tick  = now;
+            cc->u.bbr.pacing_gain = g_bbr_cycle[cc->u.bbr.cycle_idx];
+        }
+    }
+
+    if (expired && cc->u.bbr.mode != BBR_PROBE_RTT) { // drain pipe to measure min rtt again
+        cc->u.bbr.prior_cwnd     = MAX(cc->u.bbr.prior_cwnd, ffrdp->cwnd);
+        cc->u.bbr.probe_rtt_done = 0;
+        bbr_set_mode(ffrdp, BBR_PROBE_RTT);
+    }
+    if (cc->u.bbr.mode == BBR_PROBE_RTT) {
+        if (!cc->u.bbr.probe_rtt_done && CC_FLIGHT(ffrdp) <= BBR_MIN_CWND) {
+            cc->u.bbr.probe_rtt_done  = (now + BBR_PROBE_RTT_TIME) | 1;
+            cc->u.bbr.probe_rtt_round = 0;
+        } else if (cc->u.bbr.probe_rtt_done) {
+            if (cc->u.bbr.round_start) cc->u.bbr.probe_rtt_round = 1;
+            if (cc->u.bbr.probe_rtt_round && (int32_t)(now - cc->u.bbr.probe_rtt_done) >= 0) {
+                cc->u.bbr.min_rtt_tick = now;
+                ffrdp->cwnd = MAX(ffrdp->cwnd, cc->u.bbr.prior_cwnd); cc->u.bbr.prior_cwnd = 0;
+                bbr_set_mode(ffrdp, cc->u.bbr.filled ? BBR_PROBE_BW : BBR_STARTUP);
+            }
+        }
+    }
+}
+
+static void bbr_on_ack(FFRDPCONTEXT *ffrdp, uint32_t acked, uint32_t rttm) // bbr v1 (draft-cardwell-iccrg-bbr-congestion-control-00)
+{
+    FFRDP_CC_STATE *cc = &ffrdp->cc_state;
+    uint32_t target, recovery = cc_recovery(ffrdp);
+    (void)rttm;
+    bbr_update_model(ffrdp, get_tick_count());
+    target = bbr_bdp(ffrdp, cc->u.bbr.cwnd_gain) + 3; // allow 3 more frames for delayed and aggregated acks
+    if (cc->u.bbr.inrecovery && !recovery) { ffrdp->cwnd = MAX(ffrdp->cwnd, cc->u.bbr.prior_cwnd); cc->u.bbr.prior_cwnd = 0; } // recovery ends
+    cc->u.bbr.inrecovery = recovery;
+    if (recovery == CC_RECOVERY_FAST) ffrdp->cwnd = MAX(ffrdp->cwnd, CC_FLIGHT(ffrdp) + acked); // packet conservation, a lost frame doesn't shrink the model
+    else if (cc->u.bbr.filled) ffrdp->cwnd = MIN(ffrdp->cwnd + acked, target);
+    else if (ffrdp->cwnd < target) ffrdp->cwnd += acked;
+    if (cc->u.bbr.mode == BBR_PROBE_RTT) ffrdp->cwnd = MIN(ffrdp->cwnd, BBR_MIN_CWND);
+    ffrdp->cwnd = MAX(ffrdp->cwnd, BBR_MIN_CWND);
+    cc_clamp(ffrdp);
+}
+
+static void bbr_on_loss(FFRDPCONTEXT *ffrdp)
+{
+    if (cc_recovery(ffrdp)) return;
+    ffrdp->cc_state.u.bbr.prior_cwnd = MAX(ffrdp->cc_state.u.bbr.prior_cwnd, ffrdp->cwnd);
+    ffrdp->cc_state.u.bbr.inrecovery = CC_RECOVERY_FAST;
+    ffrdp->cwnd = MAX(CC_FLIGHT(ffrdp), BBR_MIN_CWND);
+    cc_enter_recovery(ffrdp, CC_RECOVERY_FAST);
+    cc_clamp(ffrdp);
+}
+
+static void bbr_on_rto(FFRDPCONTEXT *ffrdp)
+{
+    if (!cc_recovery(ffrdp)) ffrdp->cc_state.u.bbr.prior_cwnd = MAX(ffrdp->cc_state.u.bbr.prior_cwnd, ffrdp->cwnd);
+    ffrdp->cc_state.u.bbr.inrecovery = CC_RECOVERY_LOSS;
+    ffrdp->cwnd = FFRDP_MIN_CWND_SIZE;
+    cc_enter_recovery(ffrdp, CC_RECOVERY_LOSS);
+}
+
+static uint64_t bbr_pacing_rate(FFRDPCONTEXT *ffrdp)
+{
+    if (!ffrdp->cc_state.u.bbr.btlbw) { // no bandwidth sample yet, initial cwnd per srtt
+        if (ffrdp->rtts == (uint32_t)-1) return 0;
+        return (uint64_t)ffrdp->cwnd * (4 + ffrdp->smss) * 1000 * ffrdp->cc_state.u.bbr.pacing_gain / BBR_UNIT / MAX(ffrdp->rtts, 1);
+    }
+    return (uint64_t)ffrdp->cc_state.u.bbr.btlbw * ffrdp->cc_state.u.bbr.pacing_gain / BBR_UNIT * 99 / 100; // pace 1% below estimate to keep queue empty
+}
+
+#define LEDBAT_GAIN 1
+static void ledbat_on_ack(FFRDPCONTEXT *ffrdp, uint32_t acked, uint32_t rttm) // ledbat (rfc 6817) on rtt, cwnd grows below target queueing delay and shrinks above it
+{
+    FFRDP_CC_STATE *cc = &ffrdp->cc_state;
+    int64_t target = ffrdp->target_delay, off;
+    if (cc_recovery(ffrdp) == CC_RECOVERY_FAST) return;
+    if (!ffrdp->srtt_us) { newreno_on_ack(ffrdp, acked, rttm); return; } // no us rtt sample yet
+    if (ffrdp->cwnd < ffrdp->ssthresh) {
+        if (ffrdp->qdelay < target / 2) { ffrdp->cwnd += acked; cc_clamp(ffrdp); return; } // slow start until half of target is queued
+        ffrdp->ssthresh = ffrdp->cwnd;
+    }
+    off = target - (int64_t)ffrdp->qdelay;
+    cc->u.ledbat.frac += (int32_t)MAX(-1024 * 64, LEDBAT_GAIN * off * 1024 * acked / (target * ffrdp->cwnd));
+    ffrdp->cwnd = (uint32_t)MAX((int32_t)ffrdp->cwnd + cc->u.ledbat.frac / 1024, FFRDP_MIN_CWND_SIZE);
+    cc->u.ledbat.frac %= 1024;
+    ffrdp->cwnd = MIN(ffrdp->cwnd, CC_FLIGHT(ffrdp) + acked + 1); // cwnd doesn't grow beyond what is sent
+    cc_clamp(ffrdp);
+}
+
+static void ledbat_on_loss(FFRDPCONTEXT *ffrdp)
+{
+    if (cc_recovery(ffrdp)) return;
+    ffrdp->cwnd = ffrdp->ssthresh = MAX(ffrdp->cwnd / 2, 2);
+    ffrdp->cc_state.u.ledbat.frac = 0;
+    cc_enter_recovery(ffrdp, CC_RECOVERY_FAST);
+    cc_clamp(ffrdp);
+}
+
+static const FFRDP_CC_OPS g_cc_ops[] = { // indexed by FFRDP_CC_*
+    { "newreno", newreno_init, newreno_on_ack, newreno_on_loss, newreno_on_rto, cc_on_send   , cc_pacing_rate , cc_cwnd },
+    { "cubic"  , cubic_init  , cubic_on_ack  , cubic_on_loss  , cubic_on_rto  , cubic_on_send, cc_pacing_rate , cc_cwnd },
+    { "bbr"    , bbr_init    , bbr_on_ack    , bbr_on_loss    , bbr_on_rto    , NULL         , bbr_pacing_rate, cc_cwnd }, // model based, no restart after idle
+    { "ledbat" , newreno_init, ledbat_on_ack , ledbat_on_loss , newreno_on_rto, cc_on_send   , cc_pacing_rate , cc_cwnd },
+};
+
+static void ffrdp_rate_on_send(FFRDPCONTEXT *ffrdp, FFRDP_FRAME_NODE *frame, uint32_t now) // stamp delivery state on each (re)send, now is us tick
+{
+    if (CC_FLIGHT(ffrdp) == 0) ffrdp->dlv_tick = ffrdp->dlv_first = now; // restart from idle, don't count idle time in sample interval
+    frame->dlv_bytes = ffrdp->dlv_bytes;
+    frame->dlv_tick  = ffrdp->dlv_tick;
+    frame->dlv_first = ffrdp->dlv_first;
+    frame->dlv_sent  = now;
+    if (ffrdp->dlv_applimited) frame->flags |= FLAG_APP_LIMITED;
+    else frame->flags &= ~FLAG_APP_LIMITED;
+}
+
+static void ffrdp_rate_on_ack(FFRDPCONTEXT *ffrdp, FFRDP_FRAME_NODE *frame, uint32_t now) // delivery rate sample of acked frame, now is us tick
+{
+    uint32_t interval, rate;
+    ffrdp->dlv_bytes += frame_payload_size(frame);
+    ffrdp->dlv_tick   = now;
+    if (ffrdp->dlv_applimited && (int32_t)(ffrdp->dlv_bytes - ffrdp->dlv_applimited) > 0) ffrdp->dlv_applimited = 0;
+    if (!(frame->flags & FLAG_TIMEOUT_RESEND)) ffrdp->rs_rtt = MIN(ffrdp->rs_rtt, now - frame->dlv_sent);
+    if ((int32_t)(frame->dlv_sent - ffrdp->dlv_first) > 0) ffrdp->dlv_first = frame->dlv_sent;
+    interval = MAX(now - frame->dlv_tick, frame->dlv_sent - frame->dlv_first); // ack rate may be higher than send rate by ack compression
+    if (!interval) return;
+    rate = (uint32_t)MIN((uint64_t)(ffrdp->dlv_bytes - frame->dlv_bytes) * 1000000 / interval, 0xFFFFFFFF);
+    if (rate > ffrdp->rs_rate) { ffrdp->rs_rate = rate; ffrdp->rs_applimited = !!(frame->flags & FLAG_APP_LIMITED); }
+}
+
+static void ffrdp_delay_update(FFRDPCONTEXT *ffrdp, uint32_t rtt, uint32_t now) // rtt is us sample, now is ms tick
+{
+    int i;
+    if ((int32_t)(now - ffrdp->base_tick) >= 60 * 1000) { // start a new minute of base rtt history
+        ffrdp->base_idx = (ffrdp->base_idx + 1) % FFRDP_BASE_HISTORY;
+        ffrdp->base_hist[ffrdp->base_idx] = (uint32_t)-1;
+        ffrdp->base_tick = now;
+    }
+    ffrdp->base_hist[ffrdp->base_idx] = MIN(ffrdp->base_hist[ffrdp->base_idx], rtt);
+    for (ffrdp->base_rtt=(uint32_t)-1,i=0; i<FFRDP_BASE_HISTORY; i++) ffrdp->base_rtt = MIN(ffrdp->base_rtt, ffrdp->base_hist[i]);
+    ffrdp->srtt_us = ffrdp->srtt_us ? (7 * ffrdp->srtt_us + rtt) / 8 : rtt;
+    ffrdp->qdelay  = ffrdp->srtt_us > ffrdp->base_rtt ? ffrdp->srtt_us - ffrdp->base_rtt : 0;
+    ffrdp->counter_qdelay_max = MAX(ffrdp->counter_qdelay_max, ffrdp->qdelay);
+}
+
+static void ffrdp_cc_on_ack(FFRDPCONTEXT *ffrdp, uint32_t acked, uint32_t rttm)
+{
+#ifdef CONFIG_ENABLE_CC_PROFILE
+    uint64_t tick = get_tick_ns();
+    ffrdp->cc->on_ack(ffrdp, acked, rttm);
+    ffrdp->counter_cc_ack_ns += get_tick_ns() - tick;
+#else
+    ffrdp->cc->on_ack(ffrdp, acked, rttm);
+#endif
+    ffrdp->counter_cc_ack++;
+}
+
+#ifdef CONFIG_ENABLE_PACING
+static int ffrdp_pace(FFRDPCONTEXT *ffrdp, FFRDP_FRAME_NODE *frame) // return -1 if frame must wait for its departure time, else departure time is saved in pace_txtime
+{
+    uint64_t now = get_tick_us(), rate = ffrdp->pace_rate ? (uint64_t)MAX(ffrdp->pace_rate, 0) : ffrdp->cc->pacing_rate(ffrdp);
+    if (!rate) { ffrdp->pace_txtime = 0; return 0; } // no rate yet or pacing disabled, send without pacing
+    if (ffrdp->pace_next < now) ffrdp->pace_next = now; // idle time does not give burst credit
+    if (ffrdp->pace_next > now + (ffrdp->flags & FLAG_TXTIME ? FFRDP_TXTIME_HORIZON : FFRDP_PACE_HORIZON)) { ffrdp->counter_pace_wait++; return -1; }
+    ffrdp->pace_txtime = (ffrdp->flags & FLAG_TXTIME) ? ffrdp->pace_next : 0;
+    ffrdp->pace_next  += (uint64_t)frame->size * 1000000 / rate;
+    return 0;
+}
+
+static int32_t ffrdp_pace_wait(FFRDPCONTEXT *ffrdp) // us until next data frame can be sent
+{
+    uint64_t now = get_tick_us(), horizon = ffrdp->flags & FLAG_TXTIME ? FFRDP_TXTIME_HORIZON : FFRDP_PACE_HORIZON;
+    return ffrdp->pace_next > now + horizon ? (int32_t)(ffrdp->pace_next - now - horizon) : 0;
+}
+#endif
+
+#ifdef CONFIG_ENABLE_ZEROCOPY
+static void ffrdp_zc_pin(FFRDPCONTEXT *ffrdp, FFRDP_FRAME_NODE *node, uint32_t id)
+{
+    uint32_t i = (ffrdp->zc_head + ffrdp->zc_num++) & (FFRDP_ZC_MAXPEND - 1);
+    ffrdp->zc_pend[i].id   = id;
+    ffrdp->zc_pend[i].node = node;
+    node->flags |= FLAG_ZC_PENDING;
+}
+
+static void ffrdp_zc_complete(FFRDPCONTEXT *ffrdp) // read zerocopy completions from socket error queue, unpin and free finished frame nodes
+{
+    uint64_t ctl[(CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(struct sockaddr_in)) + 7) / 8];
+    struct msghdr             msg;
+    struct cmsghdr           *cmsg;
+    struct sock_extended_err *serr;
+    FFRDP_FRAME_NODE         *node;
+    uint32_t lo, hi, i, j;
+    while (ffrdp->zc_num > 0) {
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control    = ctl;
+        msg.msg_controllen = sizeof(ctl);
+        if (recvmsg(ffrdp->udp_fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) break; // kernel merges consecutive completions, so one read usually covers a whole batch
+        for (cmsg=CMSG_FIRSTHDR(&msg); cmsg; cmsg=CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level != SOL_IP || cmsg->cmsg_type != IP_RECVERR) continue;
+            serr = (struct sock_extended_err*)CMSG_DATA(cmsg);
+            if (serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY || serr->ee_errno != 0) continue;
+            lo = serr->ee_info; hi = serr->ee_data; // completed send ids are [lo, hi]
+            if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) ffrdp->counter_zc_copied += hi - lo + 1;
+            for (i=0; i<ffrdp->zc_num; i++) {
+                j = (ffrdp->zc_head + i) & (FFRDP_ZC_MAXPEND - 1);
+                if (!(node = ffrdp->zc_pend[j].node) || (int32_t)(ffrdp->zc_pend[j].id - lo) < 0) continue;
+                if ((int32_t)(ffrdp->zc_pend[j].id - hi) > 0) break;
+                node->flags &= ~FLAG_ZC_PENDING;
+                if (node->flags & FLAG_ZC_ORPHAN) frame_node_free(node);
+                ffrdp->zc_pend[j].node = NULL;
+            }
+        }
+        while (ffrdp->zc_num > 0 && ffrdp->zc_pend[ffrdp->zc_head].node == NULL) {
+            ffrdp->zc_head = (ffrdp->zc_head + 1) & (FFRDP_ZC_MAXPEND - 1);
+            ffrdp->zc_num--;
+        }
+    }
+}
+
+static void ffrdp_zc_free(FFRDPCONTEXT *ffrdp) // socket is closed, no completion will come
+{
+    FFRDP_FRAME_NODE *node;
+    uint32_t i;
+    for (i=0; i<ffrdp->zc_num; i++) {
+        if (!(node = ffrdp->zc_pend[(ffrdp->zc_head + i) & (FFRDP_ZC_MAXPEND - 1)].node)) continue;
+        node->flags &= ~FLAG_ZC_PENDING;
+        if (node->flags & FLAG_ZC_ORPHAN) frame_node_free(node);
+    }
+    ffrdp->zc_num = 0;
+}
+#endif
+
+#define GSO_UNSUPPORTED(err) ((err) == EIO || (err) == EINVAL || (err) == ENOPROTOOPT || (err) == EOPNOTSUPP) // send error of gso datagram when kernel or device can't do it
+
+static int ffrdp_txq_done(FFRDPCONTEXT *ffrdp, int n) // first n queued datagrams were sent, restore frames of the others for next update
+{
+    FFRDP_TXQ_ITEM *item;
+    int i, hasdata = 0, failed1st = 0, rtorestored = 0;
+    ffrdp->counter_send_packet += n;
+
+    for (i=0; i<ffrdp->txq_num; i++) {
+        item = &ffrdp->txq[i];
+        if (item->type == TXQ_DATA_1ST || item->type == TXQ_DATA_RESEND) hasdata = 1;
+        if (i >= n) { // not sent, restore frame states as if it was never queued
+            switch (item->type) {
+            case TXQ_DATA_1ST:
+                item->node->flags = item->flags;
+                timer_del(&item->node->timer);
+                ffrdp->send_next--; ffrdp->swnd++; ffrdp->counter_send_1sttime--; failed1st = 1; // failed first sends are the tail of sent frames
+                break;
+            case TXQ_DATA_RESEND:
+                item->node->flags        = item->flags;
+                item->node->tick_send    = item->tick_send;
+                item->node->tick_timeout = item->tick_timeout;
+                timer_link(&ffrdp->timer_due, &item->node->timer);
+                if (!rtorestored) { ffrdp->rto = item->rto; rtorestored = 1; }
+                if (item->flags & FLAG_FAST_RESEND) ffrdp->counter_resend_fast--;
+                else ffrdp->counter_resend_rto--;
+                break;
+            }
+        }
+        if (item->type == TXQ_FEC) frame_node_free(item->node);
+    }
+    if (n < ffrdp->txq_num) {
+        ffrdp->counter_udpsenderr++;
+        if (failed1st) ffrdp->cc->on_loss(ffrdp);
+    } else if (hasdata) ffrdp->counter_udpsenderr = 0;
+    i = n < ffrdp->txq_num ? -1 : 0;
+    ffrdp->txq_num = 0;
+    return i;
+}
+
+#ifdef CONFIG_ENABLE_IOURING
+static int ffrdp_iour_txdone(FFRDPCONTEXT *ffrdp) // take results of sends submitted by last flush, tx queue is reusable after it
+{
+    int ret, n, i;
+    if (ffrdp->iour_txmsgs == 0) return 0;
+    for (ffrdp_iour_reap(ffrdp); ffrdp->iour_txpending > 0; ffrdp_iour_reap(ffrdp)) ffrdp_iour_enter(ffrdp, 1, -1); // rarely waits, sends were submitted an update or a receive ago
+    for (ret=0; ret<ffrdp->iour_txmsgs && ffrdp->iour_txres[ret] >= 0; ret++); // sends after a failed one were cancelled, just like sendmmsg
+#ifdef CONFIG_ENABLE_GSO
+    if (ret == 0 && ffrdp->txmmsg_cnt[0] > 1 && GSO_UNSUPPORTED(-ffrdp->iour_txres[0])) ffrdp->flags &= ~FLAG_UDP_GSO;
+#endif
+    for (n=0,i=0; i<ret; i++) n += ffrdp->txmmsg_cnt[i];
+    ffrdp->iour_txmsgs = 0;
+    return ffrdp_txq_done(ffrdp, n);
+}
+#endif
+
+static int ffrdp_txq_flush(FFRDPCONTEXT *ffrdp) // send all queued datagrams, frames not sent are restored for next update
+{
+    struct sockaddr_in *dstaddr = ffrdp->flags & FLAG_SERVER ? &ffrdp->client_addr : &ffrdp->server_addr;
+    int n, ret;
+#ifdef CONFIG_ENABLE_MMSG
+    int m, i, j, cnt, zc = 0;
+#else
+    FFRDP_TXQ_ITEM *item;
+#endif
+#if defined(CONFIG_ENABLE_GSO) || defined(CONFIG_ENABLE_TXTIME)
+    FFRDP_TXQ_ITEM *item;
+    struct cmsghdr *cmsg;
+    int ctllen;
+#endif
+#ifdef CONFIG_ENABLE_IOURING
+    ffrdp_iour_txdone(ffrdp); // sends of last flush must complete before tx queue is reused
+#endif
+    if (ffrdp->txq_num == 0) return 0;
+#ifdef CONFIG_ENABLE_ZEROCOPY
+    zc = (ffrdp->flags & FLAG_ZEROCOPY) && !(ffrdp->flags & FLAG_IOURING) && ffrdp->txq_num <= (int)(FFRDP_ZC_MAXPEND - ffrdp->zc_num);
+    for (i=0; zc && i<ffrdp->txq_num; i++) {
+        if (ffrdp->txq[i].type == TXQ_CTRL) zc = 0; // ack/query data lives in tx queue and is reused, can't be pinned, copy this small batch
+    }
+#endif
+#ifdef CONFIG_ENABLE_MMSG
+    for (i=0,m=0; i<ffrdp->txq_num; i+=cnt,m++) {
+        cnt  = 1;
+#if defined(CONFIG_ENABLE_GSO) || defined(CONFIG_ENABLE_TXTIME)
+        item = &ffrdp->txq[i];
+#endif
+#ifdef CONFIG_ENABLE_GSO
+        if ((ffrdp->flags & FLAG_UDP_GSO) && item->size >= 4 + ffrdp->smss) { // run of full frames is sent as one gso datagram
+            j = MIN(FFRDP_GSO_MAXSEGS, FFRDP_GSO_MAXSIZE / item->size);
+            while (i + cnt < ffrdp->txq_num && cnt < j && ffrdp->txq[i + cnt].size == item->size && ffrdp->txq[i + cnt].txtime == item->txtime) cnt++;
+        }
+#endif
+        for (j=i; j<i+cnt; j++) {
+            ffrdp->txmmsg_iov[j].iov_base = ffrdp->txq[j].node ? ffrdp->txq[j].node->data : ffrdp->txq[j].ctrl;
+            ffrdp->txmmsg_iov[j].iov_len  = ffrdp->txq[j].size;
+        }
+        memset(&ffrdp->txmmsg_hdr[m], 0, sizeof(struct mmsghdr));
+        if (!(ffrdp->flags & FLAG_UDP_CONNECTED)) { // no per-datagram route lookup for connected socket
+            ffrdp->txmmsg_hdr[m].msg_hdr.msg_name    = dstaddr;
+            ffrdp->txmmsg_hdr[m].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+        }
+        ffrdp->txmmsg_hdr[m].msg_hdr.msg_iov     = &ffrdp->txmmsg_iov[i];
+        ffrdp->txmmsg_hdr[m].msg_hdr.msg_iovlen  = cnt;
+#if defined(CONFIG_ENABLE_GSO) || defined(CONFIG_ENABLE_TXTIME)
+        ctllen = 0;
+#endif
+#ifdef CONFIG_ENABLE_GSO
+        if (cnt > 1) {
+            cmsg = (struct cmsghdr*)((uint8_t*)ffrdp->txmmsg_ctl[m] + ctllen);
+            cmsg->cmsg_level = SOL_UDP;
+            cmsg->cmsg_type  = UDP_SEGMENT;
+            cmsg->cmsg_len   = CMSG_LEN(sizeof(uint16_t));
+            *(uint16_t*)CMSG_DATA(cmsg) = item->size;
+            ctllen += CMSG_SPACE(sizeof(uint16_t));
+        }
+#endif
+#ifdef CONFIG_ENABLE_TXTIME
+        if (item->txtime) {
+            cmsg = (struct cmsghdr*)((uint8_t*)ffrdp->txmmsg_ctl[m] + ctllen);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type  = SCM_TXTIME;
+            cmsg->cmsg_len   = CMSG_LEN(sizeof(uint64_t));
+            *(uint64_t*)CMSG_DATA(cmsg) = item->txtime * 1000; // ns
+            ctllen += CMSG_SPACE(sizeof(uint64_t));
+        }
+#endif
+#if defined(CONFIG_ENABLE_GSO) || defined(CONFIG_ENABLE_TXTIME)
+        if (ctllen) {
+            ffrdp->txmmsg_hdr[m].msg_hdr.msg_control    = ffrdp->txmmsg_ctl[m];
+            ffrdp->txmmsg_hdr[m].msg_hdr.msg_controllen = ctllen;
+        }
+#endif
+        ffrdp->txmmsg_cnt[m] = cnt;
+    }
+#ifdef CONFIG_ENABLE_IOURING
+    if (ffrdp->flags & FLAG_IOURING) {
+        if ((ret = ffrdp_iour_sendmsgs(ffrdp, ffrdp->txmmsg_hdr, m)) > 0) return 0; // completions are reaped by ffrdp_iour_txdone, tx queue and mmsghdrs stay in use till then
+    } else
+#endif
+    {
+        ffrdp->counter_send_syscall++;
+        ret = sendmmsg(ffrdp->udp_fd, ffrdp->txmmsg_hdr, m, zc ? MSG_ZEROCOPY : 0); // sendmmsg stops at the first datagram failed to send
+    }
+#ifdef CONFIG_ENABLE_GSO
+    if (ret < 0 && ffrdp->txmmsg_cnt[0] > 1 && GSO_UNSUPPORTED(errno)) {
+        ffrdp->flags &= ~FLAG_UDP_GSO; // gso not supported by kernel or device, frames will be resent one by one
+    }
+#endif
+    for (n=0,i=0; i<ret; i++) n += ffrdp->txmmsg_cnt[i];
+#ifdef CONFIG_ENABLE_ZEROCOPY
+    for (i=0,j=0; zc && i<ret; i++,ffrdp->zc_nextid++) { // each datagram sent gets the next completion id
+        for (cnt=0; cnt<ffrdp->txmmsg_cnt[i]; cnt++,j++) ffrdp_zc_pin(ffrdp, ffrdp->txq[j].node, ffrdp->zc_nextid);
+        ffrdp->counter_zc_send++;
+    }
+#endif
+#else
+    for (n=0; n<ffrdp->txq_num; n++) {
+        item = &ffrdp->txq[n];
+        ffrdp->counter_send_syscall++;
+        if (ffrdp->flags & FLAG_UDP_CONNECTED) ret = send(ffrdp->udp_fd, item->node ? (char*)item->node->data : (char*)item->ctrl, item->size, 0);
+        else ret = sendto(ffrdp->udp_fd, item->node ? (char*)item->node->data : (char*)item->ctrl, item->size, 0, (struct sockaddr*)dstaddr, sizeof(struct sockaddr_in));
+        if (ret != item->size) break;
     }
+#endif
+    return ffrdp_txq_done(ffrdp, n);
 }
 
-static void list_remove(FFRDP_FRAME_NODE **head, FFRDP_FRAME_NODE **tail, FFRDP_FRAME_NODE *node)
-{
-    if (node->next) node->next->prev = node->prev;
-    else *tail = node->prev;
-    if (node->prev) node->prev->next = node->next;
-    else *head = node->next;
-    free(node);
-}
-
-static void list_free(FFRDP_FRAME_NODE **head, FFRDP_FRAME_NODE **tail)
+static int ffrdp_txq_reserve(FFRDPCONTEXT *ffrdp, int num) // make sure tx queue has num free items, return -1 if flushing queue failed
 {
-    while (*head) list_remove(head, tail, *head);
+#ifdef CONFIG_ENABLE_IOURING
+    if (ffrdp_iour_txdone(ffrdp) != 0) return -1; // items of sends in flight can't be overwritten
+#endif
+    return ffrdp->txq_num + num > FFRDP_TXQ_SIZE ? ffrdp_txq_flush(ffrdp) : 0;
 }
 
-static int ffrdp_sleep(FFRDPCONTEXT *ffrdp, int flag)
+static FFRDP_TXQ_ITEM* ffrdp_txq_push(FFRDPCONTEXT *ffrdp, int type, FFRDP_FRAME_NODE *node, int size) // caller must reserve item first
 {
-    if (ffrdp->flags & FLAG_FLUSH) { ffrdp->flags &= ~FLAG_FLUSH; return 0; }
-    if (flag) {
-        struct timeval tv;
-        fd_set  rs;
-        FD_ZERO(&rs);
-        FD_SET(ffrdp->udp_fd, &rs);
-        tv.tv_sec  = 0;
-        tv.tv_usec = FFRDP_SELECT_TIMEOUT;
-        if (select((int)ffrdp->udp_fd + 1, &rs, NULL, NULL, &tv) <= 0) return -1;
-    } else usleep(FFRDP_USLEEP_TIMEOUT);
-    return 0;
+    FFRDP_TXQ_ITEM *item = &ffrdp->txq[ffrdp->txq_num++];
+    item->type = type;
+    item->node = node;
+    item->size = size;
+#ifdef CONFIG_ENABLE_PACING
+    item->txtime = type == TXQ_CTRL ? 0 : ffrdp->pace_txtime; // fec frame leaves with the data frame before it
+#else
+    item->txtime = 0;
+#endif
+    if (type == TXQ_DATA_1ST || type == TXQ_DATA_RESEND) {
+        item->flags        = node->flags;
+        item->tick_send    = node->tick_send;
+        item->tick_timeout = node->tick_timeout;
+        item->rto          = ffrdp->rto;
+    }
+    return item;
 }
 
-static int ffrdp_send_data_frame(FFRDPCONTEXT *ffrdp, FFRDP_FRAME_NODE *frame, struct sockaddr_in *dstaddr)
+static int ffrdp_send_data_frame(FFRDPCONTEXT *ffrdp, FFRDP_FRAME_NODE *frame, int type)
 {
+    FFRDP_FRAME_NODE *fec;
+    if (ffrdp_txq_reserve(ffrdp, 2) != 0) return -1;
     switch (frame->size - ffrdp->smss) {
     case 6 : ffrdp->counter_fec_tx ++; *(uint16_t*)(frame->data + 4 + ffrdp->smss) = ffrdp->fec_txseq++; break; // tx fec frame
     case 4 : ffrdp->counter_txfull ++; break; // tx full  frame
     default: ffrdp->counter_txshort++; break; // tx short frame
     }
-    if (sendto(ffrdp->udp_fd, frame->data, frame->size, 0, (struct sockaddr*)dstaddr, sizeof(struct sockaddr_in)) != frame->size) { ffrdp->counter_udpsenderr++; return -1; }
-    else ffrdp->counter_udpsenderr = 0;
+    ffrdp_txq_push(ffrdp, type, frame, frame->size);
     if (frame->size == 4 + ffrdp->smss + 2) { // fec frame
         uint32_t *psrc = (uint32_t*)frame->data, *pdst = (uint32_t*)ffrdp->fec_txbuf, i;
         for (i=0; i<(4+ffrdp->smss)/sizeof(uint32_t); i++) *pdst++ ^= *psrc++; // make xor fec frame
         if (ffrdp->fec_txseq % ffrdp->fec_txredundancy == ffrdp->fec_txredundancy - 1) {
             *(uint16_t*)(ffrdp->fec_txbuf + 4 + ffrdp->smss) = ffrdp->fec_txseq++; ffrdp->fec_txbuf[0] = ffrdp->fec_txredundancy;
-            sendto(ffrdp->udp_fd, ffrdp->fec_txbuf, frame->size, 0, (struct sockaddr*)dstaddr, sizeof(struct sockaddr_in)); // send fec frame
+            if ((fec = frame_node_new(&ffrdp->pool, ffrdp->fec_txredundancy, ffrdp->smss))) { // queue fec frame, it will be freed after flush
+                memcpy(fec->data, ffrdp->fec_txbuf, frame->size);
+                ffrdp_txq_push(ffrdp, TXQ_FEC, fec, frame->size);
+            }
             memset(ffrdp->fec_txbuf, 0, sizeof(ffrdp->fec_txbuf)); // clear tx_fecbuf
             ffrdp->counter_fec_tx++;
         }
@@ -275,6 +1697,15 @@ static int ffrdp_send_data_frame(FFRDPCONTEXT *ffrdp, FFRDP_FRAME_NODE *frame, s
     return 0;
 }
 
+static int ffrdp_send_ctrl_frame(FFRDPCONTEXT *ffrdp, uint8_t *data, int size)
+{
+    FFRDP_TXQ_ITEM *item;
+    if (ffrdp_txq_reserve(ffrdp, 1) != 0) return -1;
+    item = ffrdp_txq_push(ffrdp, TXQ_CTRL, NULL, size);
+    memcpy(item->ctrl, data, size);
+    return 0;
+}
+
 static int ffrdp_recv_data_frame(FFRDPCONTEXT *ffrdp, FFRDP_FRAME_NODE *frame)
 {
     uint32_t fecseq, fecrdc, *psrc, *pdst, type, i;
@@ -306,7 +1737,7 @@ static int ffrdp_recv_data_frame(FFRDPCONTEXT *ffrdp, FFRDP_FRAME_NODE *frame)
     return 0;
 }
 
-void* ffrdp_init(char *ip, int port, char *txkey, char *rxkey, int server, int smss, int sfec)
+static void* ffrdp_open(char *ip, int port, char *txkey, char *rxkey, int server, int smss, int sfec, struct sockaddr_in *peer) // peer: server context for one client accepted by ffrdp_loop
 {
     FFRDPCONTEXT *ffrdp = NULL;
     unsigned long opt;
@@ -319,13 +1750,19 @@ void* ffrdp_init(char *ip, int port, char *txkey, char *rxkey, int server, int s
     }
 #endif
 
-    if (!(ffrdp = calloc(1, sizeof(FFRDPCONTEXT)))) return NULL;
+    if (!(ffrdp = aligned_malloc(sizeof(FFRDPCONTEXT), FFRDP_CACHELINE))) return NULL; // hot block starts at a cache line
+    memset(ffrdp, 0, sizeof(FFRDPCONTEXT));
     ffrdp->swnd     = FFRDP_DEF_CWND_SIZE;
-    ffrdp->cwnd     = FFRDP_DEF_CWND_SIZE;
-    ffrdp->ssthresh = FFRDP_DEF_CWND_SIZE;
+    ffrdp->cc       = &g_cc_ops[FFRDP_CC_NEWRENO];
+    ffrdp->cc->init(ffrdp);
     ffrdp->rtts     = (uint32_t) -1;
     ffrdp->rto      = FFRDP_MIN_RTO;
+    ffrdp->wheel_tick = ffrdp->base_tick = get_tick_count();
+    ffrdp->target_delay = FFRDP_TARGET_DELAY * 1000;
+    memset(ffrdp->base_hist, 0xFF, sizeof(ffrdp->base_hist));
     ffrdp->rmss     = FFRDP_MAX_MSS;
+    ffrdp->recv_bufsize = ffrdp->recv_bufmin = FFRDP_RECVBUF_SIZE;
+    ffrdp->recv_bufmax  = FFRDP_RECVBUF_DEFMAX;
     ffrdp->smss     = MAX(1, MIN(smss, FFRDP_MAX_MSS));
     ffrdp->fec_txredundancy = MAX(0, MIN(sfec, FFRDP_FRAME_TYPE_FEC32));
     ffrdp->tick_ffrdp_dump  = get_tick_count();
@@ -334,6 +1771,9 @@ void* ffrdp_init(char *ip, int port, char *txkey, char *rxkey, int server, int s
     ffrdp->server_addr.sin_port        = htons(port);
     ffrdp->server_addr.sin_addr.s_addr = inet_addr(ip);
     ffrdp->udp_fd = socket(AF_INET, SOCK_DGRAM, 0);
+#ifdef CONFIG_ENABLE_IOURING
+    ffrdp->iour_fd = -1;
+#endif
     if (ffrdp->udp_fd < 0) {
         printf("failed to open socket !\n");
         goto failed;
@@ -347,6 +1787,26 @@ void* ffrdp_init(char *ip, int port, char *txkey, char *rxkey, int server, int s
     opt = FFRDP_UDPSBUF_SIZE; setsockopt(ffrdp->udp_fd, SOL_SOCKET, SO_SNDBUF   , (char*)&opt, sizeof(int)); // setup udp send buffer size
     opt = FFRDP_UDPRBUF_SIZE; setsockopt(ffrdp->udp_fd, SOL_SOCKET, SO_RCVBUF   , (char*)&opt, sizeof(int)); // setup udp recv buffer size
     opt = 1;                  setsockopt(ffrdp->udp_fd, SOL_SOCKET, SO_REUSEADDR, (char*)&opt, sizeof(int)); // setup reuse addr
+#ifndef WIN32
+    opt = 1; if (peer) setsockopt(ffrdp->udp_fd, SOL_SOCKET, SO_REUSEPORT, (char*)&opt, sizeof(int)); // share port with listeners
+#endif
+
+#ifdef CONFIG_ENABLE_GSO
+    opt = 0; if (setsockopt(ffrdp->udp_fd, SOL_UDP, UDP_SEGMENT, (char*)&opt, sizeof(int)) == 0) ffrdp->flags |= FLAG_UDP_GSO; // check kernel udp gso support
+#endif
+#ifdef CONFIG_ENABLE_IOURING
+    if (ffrdp_iour_init(ffrdp) == 0) ffrdp->flags |= FLAG_IOURING;
+    else ffrdp_iour_free(ffrdp); // io_uring not available, fallback to recvmmsg/sendmmsg
+#endif
+#ifdef CONFIG_ENABLE_ZEROCOPY
+    opt = 1; if (!(ffrdp->flags & FLAG_IOURING) && setsockopt(ffrdp->udp_fd, SOL_SOCKET, SO_ZEROCOPY, (char*)&opt, sizeof(int)) == 0) ffrdp->flags |= FLAG_ZEROCOPY; // enable zerocopy send, not used by io_uring path
+#endif
+#ifdef CONFIG_ENABLE_TXTIME
+    { struct sock_txtime txtime = { CLOCK_MONOTONIC, 0 }; if (setsockopt(ffrdp->udp_fd, SOL_SOCKET, SO_TXTIME, (char*)&txtime, sizeof(txtime)) == 0) ffrdp->flags |= FLAG_TXTIME; } // needs fq or etf qdisc on egress device, else software pacing
+#endif
+#ifdef CONFIG_ENABLE_GRO
+    opt = 1; if (!(ffrdp->flags & FLAG_IOURING) && setsockopt(ffrdp->udp_fd, SOL_UDP, UDP_GRO, (char*)&opt, sizeof(int)) == 0) ffrdp->flags |= FLAG_UDP_GRO; // enable udp gro receive, not used by io_uring path
+#endif
 
     if (server) {
         ffrdp->flags |= FLAG_SERVER;
@@ -354,7 +1814,15 @@ void* ffrdp_init(char *ip, int port, char *txkey, char *rxkey, int server, int s
             printf("failed to bind !\n");
             goto failed;
         }
+        if (peer) { // connected socket gets all datagrams of this client, listener only sees new clients
+            if (connect(ffrdp->udp_fd, (struct sockaddr*)peer, sizeof(struct sockaddr_in)) != 0) goto failed;
+            memcpy(&ffrdp->client_addr, peer, sizeof(ffrdp->client_addr));
+            ffrdp->flags |= FLAG_CONNECTED | FLAG_UDP_CONNECTED;
+        }
     }
+#ifdef CONFIG_ENABLE_UDP_CONNECT
+    else if (connect(ffrdp->udp_fd, (struct sockaddr*)&ffrdp->server_addr, sizeof(ffrdp->server_addr)) == 0) ffrdp->flags |= FLAG_UDP_CONNECTED;
+#endif
 
     if (txkey) {
 #ifdef CONFIG_ENABLE_AES256
@@ -371,235 +1839,476 @@ void* ffrdp_init(char *ip, int port, char *txkey, char *rxkey, int server, int s
     return ffrdp;
 
 failed:
+#ifdef CONFIG_ENABLE_IOURING
+    ffrdp_iour_free(ffrdp);
+#endif
     if (ffrdp->udp_fd > 0) closesocket(ffrdp->udp_fd);
-    free(ffrdp);
+    aligned_free(ffrdp);
     return NULL;
 }
 
+void* ffrdp_init(char *ip, int port, char *txkey, char *rxkey, int server, int smss, int sfec)
+{
+    return ffrdp_open(ip, port, txkey, rxkey, server, smss, sfec, NULL);
+}
+
 void ffrdp_free(void *ctxt)
 {
     FFRDPCONTEXT *ffrdp = (FFRDPCONTEXT*)ctxt;
+    FFRDP_FRAME_NODE *node;
+    int i;
     if (!ctxt) return;
+    if (ffrdp->loop) ffrdp_loop_del(ffrdp->loop, ffrdp);
+#ifdef CONFIG_ENABLE_IOURING
+    ffrdp_iour_txdone(ffrdp); // frees fec frames of sends in flight
+    ffrdp_iour_free(ffrdp);
+#endif
     if (ffrdp->udp_fd > 0) closesocket(ffrdp->udp_fd);
-    if (ffrdp->cur_new_node) free(ffrdp->cur_new_node);
-    list_free(&ffrdp->send_list_head, &ffrdp->send_list_tail);
-    list_free(&ffrdp->recv_list_head, &ffrdp->recv_list_tail);
-    free(ffrdp);
+#ifdef CONFIG_ENABLE_ZEROCOPY
+    ffrdp_zc_free(ffrdp);
+#endif
+    if (ffrdp->cur_new_node) frame_node_free(ffrdp->cur_new_node);
+    while ((node = ffrdp->rxpend)) { ffrdp->rxpend = node->next; frame_node_free(node); }
+    for (; ffrdp->send_head != ffrdp->send_seq; ffrdp->send_head++) {
+        if (SEND_RING_SLOT(ffrdp, ffrdp->send_head)) frame_node_free(SEND_RING_SLOT(ffrdp, ffrdp->send_head));
+    }
+    for (i=0; i<FFRDP_RECV_RING_SIZE; i++) {
+        if (ffrdp->recv_ring[i]) frame_node_free(ffrdp->recv_ring[i]);
+    }
+#ifdef CONFIG_ENABLE_GRO
+    if (ffrdp->rxgro_node) frame_node_free(ffrdp->rxgro_node);
+#endif
+#ifdef CONFIG_ENABLE_MMSG
+    for (i=0; i<FFRDP_MMSG_BATCH; i++) {
+        if (ffrdp->rxmmsg_node[i]) frame_node_free(ffrdp->rxmmsg_node[i]);
+    }
+#else
+    if (ffrdp->rxnode) frame_node_free(ffrdp->rxnode);
+#endif
+    node_pool_free(&ffrdp->pool);
+    free(ffrdp->recv_buff);
+    aligned_free(ffrdp);
 #ifdef WIN32
     WSACleanup();
     timeEndPeriod(1);
 #endif
 }
 
-int ffrdp_send(void *ctxt, char *buf, int len)
+static int ffrdp_send_check(FFRDPCONTEXT *ffrdp, int len) // check if len bytes can be queued
 {
-    FFRDPCONTEXT *ffrdp = (FFRDPCONTEXT*)ctxt;
-    int           n = len, size;
     if (  !ffrdp || ((ffrdp->flags & FLAG_SERVER) && (ffrdp->flags & FLAG_CONNECTED) == 0)
-        || ((len + ffrdp->smss - 1) / ffrdp->smss + ffrdp->wait_snd > FFRDP_MAX_WAITSND)) {
+        || ((len + ffrdp->smss - 1) / ffrdp->smss + ffrdp->wait_snd > FFRDP_MAX_WAITSND)
+        || ((len + ffrdp->smss - 1) / ffrdp->smss + ffrdp->send_seq - ffrdp->send_head >= FFRDP_SEND_RING_SIZE)) {
         if (ffrdp) ffrdp->counter_send_failed++;
         return -1;
     }
-    while (n > 0) {
-        if (!ffrdp->cur_new_node) ffrdp->cur_new_node = frame_node_new(ffrdp->fec_txredundancy, ffrdp->smss);
-        if (!ffrdp->cur_new_node) break;
-        else SET_FRAME_SEQ(ffrdp->cur_new_node, ffrdp->send_seq);
-        size = MIN(n, (int)(ffrdp->smss - ffrdp->cur_new_size));
-        memcpy(ffrdp->cur_new_node->data + 4 + ffrdp->cur_new_size, buf, size);
-        ffrdp->cur_new_size += size; buf += size; n -= size;
-        if (ffrdp->cur_new_size == ffrdp->smss) {
+    return 0;
+}
+
+static int ffrdp_send_space(FFRDPCONTEXT *ffrdp, uint8_t **ptr) // writable payload space of cur_new_node, a new node is created if needed
+{
+    if (!ffrdp->cur_new_node) ffrdp->cur_new_node = frame_node_new(&ffrdp->pool, ffrdp->fec_txredundancy, ffrdp->smss);
+    if (!ffrdp->cur_new_node) return -1;
+    else SET_FRAME_SEQ(ffrdp->cur_new_node, ffrdp->send_seq);
+    *ptr = ffrdp->cur_new_node->data + 4 + ffrdp->cur_new_size;
+    return ffrdp->smss - ffrdp->cur_new_size;
+}
+
+static void ffrdp_send_fill(FFRDPCONTEXT *ffrdp, int size) // size bytes were written into cur_new_node
+{
+    ffrdp->cur_new_size += size;
+    if (ffrdp->cur_new_size == ffrdp->smss) {
 #ifdef CONFIG_ENABLE_AES256
-            if ((ffrdp->flags & FLAG_TX_AES256)) frame_node_encrypt(ffrdp->cur_new_node, &ffrdp->aes_encrypt_key, AES_ENCRYPT);
+        if ((ffrdp->flags & FLAG_TX_AES256)) frame_node_encrypt(ffrdp->cur_new_node, &ffrdp->aes_encrypt_key, AES_ENCRYPT);
 #endif
-            list_enqueue(&ffrdp->send_list_head, &ffrdp->send_list_tail, ffrdp->cur_new_node);
-            ffrdp->send_seq++; ffrdp->wait_snd++;
-            ffrdp->cur_new_node = NULL;
-            ffrdp->cur_new_size = 0;
-        } else ffrdp->cur_new_tick = get_tick_count();
+        SEND_RING_SLOT(ffrdp, ffrdp->send_seq) = ffrdp->cur_new_node;
+        ffrdp->send_seq++; ffrdp->wait_snd++;
+        ffrdp->cur_new_node = NULL;
+        ffrdp->cur_new_size = 0;
+        timer_del(&ffrdp->timer_flush);
+    } else {
+        ffrdp->cur_new_tick = get_tick_count();
+        timer_add(ffrdp, &ffrdp->timer_flush, ffrdp->cur_new_tick + FFRDP_FLUSH_TIMEOUT + 1);
     }
-    return len - n;
 }
 
-int ffrdp_recv(void *ctxt, char *buf, int len)
+int ffrdp_sendv(void *ctxt, struct iovec *iov, int iovcnt)
+{
+    FFRDPCONTEXT *ffrdp = (FFRDPCONTEXT*)ctxt;
+    uint8_t      *ptr;
+    int           len = 0, ret = 0, off = 0, i = 0, space, size;
+    if (!iov || iovcnt < 0) return -1;
+    for (i=0; i<iovcnt; i++) len += (int)iov[i].iov_len;
+    if (ffrdp_send_check(ffrdp, len) != 0) return -1;
+    for (i=0; ret<len; ) { // fill each frame from as many iovecs as it spans
+        if ((space = ffrdp_send_space(ffrdp, &ptr)) < 0) break;
+        for (size=0; size<space && i<iovcnt; ) {
+            int n = MIN(space - size, (int)iov[i].iov_len - off);
+            memcpy(ptr + size, (uint8_t*)iov[i].iov_base + off, n);
+            size += n; off += n;
+            if (off == (int)iov[i].iov_len) { i++; off = 0; }
+        }
+        ffrdp_send_fill(ffrdp, size); ret += size;
+    }
+    return ret;
+}
+
+int ffrdp_send(void *ctxt, char *buf, int len)
+{
+    struct iovec iov = { buf, len };
+    return ffrdp_sendv(ctxt, &iov, len < 0 ? -1 : 1);
+}
+
+int ffrdp_send_reserve(void *ctxt, char **ptr, int *len)
+{
+    FFRDPCONTEXT *ffrdp = (FFRDPCONTEXT*)ctxt;
+    if (!ptr || !len || ffrdp_send_check(ffrdp, 1) != 0 || (*len = ffrdp_send_space(ffrdp, (uint8_t**)ptr)) < 0) return -1;
+    ffrdp->flags |= FLAG_SEND_RESERVED;
+    return 0;
+}
+
+int ffrdp_send_commit(void *ctxt, int len)
+{
+    FFRDPCONTEXT *ffrdp = (FFRDPCONTEXT*)ctxt;
+    if (!ffrdp || !(ffrdp->flags & FLAG_SEND_RESERVED)) return -1;
+    ffrdp->flags &= ~FLAG_SEND_RESERVED;
+    len = MAX(0, MIN(len, (int)(ffrdp->smss - ffrdp->cur_new_size)));
+    ffrdp_send_fill(ffrdp, len); // flush timer is re-armed even if nothing is written, it may have fired during reservation
+    return len;
+}
+
+int ffrdp_recv_peek(void *ctxt, struct iovec *iov, int n)
+{
+    FFRDPCONTEXT *ffrdp = (FFRDPCONTEXT*)ctxt;
+    int           head, len1;
+    if (!ctxt || !iov || n <= 0) return -1;
+    if (ffrdp->recv_size == 0) return 0;
+    ffrdp->flags |= FLAG_RECV_PEEKED;
+    head = ffrdp->recv_head % ffrdp->recv_bufsize; // recv_head may point to the end of buffer
+    len1 = MIN(ffrdp->recv_size, ffrdp->recv_bufsize - head);
+    iov[0].iov_base = ffrdp->recv_buff + head;
+    iov[0].iov_len  = len1;
+    if (len1 == ffrdp->recv_size || n < 2) return 1;
+    iov[1].iov_base = ffrdp->recv_buff;
+    iov[1].iov_len  = ffrdp->recv_size - len1;
+    return 2;
+}
+
+int ffrdp_recv_consume(void *ctxt, int len)
 {
     FFRDPCONTEXT *ffrdp = (FFRDPCONTEXT*)ctxt;
     int           ret;
     if (!ctxt) return -1;
-    ret = MIN(len, ffrdp->recv_size);
+    ffrdp->flags &= ~FLAG_RECV_PEEKED; // peeked iovecs are invalid from now on
+    ret = MAX(0, MIN(len, ffrdp->recv_size));
     if (ret > 0) {
-        ffrdp->recv_head = ringbuf_read(ffrdp->recv_buff, sizeof(ffrdp->recv_buff), ffrdp->recv_head, (uint8_t*)buf, ret);
+        ffrdp->recv_head = ringbuf_read(ffrdp->recv_buff, ffrdp->recv_bufsize, ffrdp->recv_head, NULL, ret);
         ffrdp->recv_size-= ret; ffrdp->counter_recv_bytes += ret;
+        if (ffrdp->recv_size == 0 && !ffrdp->timer_idle.pprev) timer_add(ffrdp, &ffrdp->timer_idle, ffrdp->recv_tick + FFRDP_RECVBUF_IDLE + 1);
     }
     return ret;
 }
 
+int ffrdp_recvv(void *ctxt, struct iovec *iov, int iovcnt)
+{
+    struct iovec src[2];
+    int n, i = 0, j = 0, soff = 0, doff = 0, size, ret = 0;
+    if (!iov || iovcnt < 0 || (n = ffrdp_recv_peek(ctxt, src, 2)) < 0) return -1;
+    while (i < n && j < iovcnt) { // drain the two ring segments into the user buffers
+        size = MIN((int)src[i].iov_len - soff, (int)iov[j].iov_len - doff);
+        memcpy((uint8_t*)iov[j].iov_base + doff, (uint8_t*)src[i].iov_base + soff, size);
+        soff += size; doff += size; ret += size;
+        if (soff == (int)src[i].iov_len) { i++; soff = 0; }
+        if (doff == (int)iov[j].iov_len) { j++; doff = 0; }
+    }
+    return ffrdp_recv_consume(ctxt, ret);
+}
+
+int ffrdp_recv(void *ctxt, char *buf, int len)
+{
+    struct iovec iov = { buf, len };
+    return ffrdp_recvv(ctxt, &iov, len < 0 ? -1 : 1);
+}
+
 int ffrdp_isdead(void *ctxt)
 {
     FFRDPCONTEXT *ffrdp = (FFRDPCONTEXT*)ctxt;
+    FFRDP_FRAME_NODE *head;
     if (!ctxt) return -1;
-    if (!ffrdp->send_list_head) return 0;
-    if (ffrdp->send_list_head->flags & FLAG_FIRST_SEND) {
-        return (int32_t)get_tick_count() - (int32_t)ffrdp->send_list_head->tick_1sts > FFRDP_DEAD_TIMEOUT;
+    if (ffrdp->flags & FLAG_PEER_RESET) return 1;
+    if (ffrdp->send_head == ffrdp->send_seq) return 0;
+    head = SEND_RING_SLOT(ffrdp, ffrdp->send_head);
+    if (head->flags & FLAG_FIRST_SEND) {
+        return (int32_t)get_tick_count() - (int32_t)head->tick_1sts > FFRDP_DEAD_TIMEOUT;
     } else {
         return (int32_t)ffrdp->tick_send_query - (int32_t)ffrdp->tick_recv_ack > FFRDP_DEAD_TIMEOUT || ffrdp->counter_udpsenderr > DEADLINK_SENDERR_THRESHOLD;
     }
 }
 
-static void ffrdp_recvdata_and_sendack(FFRDPCONTEXT *ffrdp, struct sockaddr_in *dstaddr)
+static void ffrdp_flush_new_node(FFRDPCONTEXT *ffrdp) // queue partly filled cur_new_node as a short frame
 {
-    FFRDP_FRAME_NODE *p;
-    int32_t dist, recv_mack, recv_wnd, size, i;
-    uint8_t data[8];
-    while (ffrdp->recv_list_head) {
-        dist = seq_distance(GET_FRAME_SEQ(ffrdp->recv_list_head), ffrdp->recv_seq);
-        if (dist == 0 && (size = frame_payload_size(ffrdp->recv_list_head)) <= (int)(sizeof(ffrdp->recv_buff) - ffrdp->recv_size)) {
-#ifdef CONFIG_ENABLE_AES256
-            if ((ffrdp->flags & FLAG_RX_AES256)) frame_node_encrypt(ffrdp->recv_list_head, &ffrdp->aes_decrypt_key, AES_DECRYPT);
-#endif
-            ffrdp->recv_tail = ringbuf_write(ffrdp->recv_buff, sizeof(ffrdp->recv_buff), ffrdp->recv_tail, ffrdp->recv_list_head->data + 4, size);
-            ffrdp->recv_size+= size;
-            ffrdp->recv_seq++; ffrdp->recv_seq &= 0xFFFFFF;
-            list_remove(&ffrdp->recv_list_head, &ffrdp->recv_list_tail, ffrdp->recv_list_head);
-        } else break;
-    }
-    for (recv_mack=0,i=0,p=ffrdp->recv_list_head; i<=24&&p; i++,p=p->next) {
-        dist = seq_distance(GET_FRAME_SEQ(p), ffrdp->recv_seq);
-        if (dist <= 24) recv_mack |= 1 << (dist - 1); // dist is obviously > 0
+    if (!ffrdp->cur_new_node || ffrdp->cur_new_size == 0 || (ffrdp->flags & FLAG_SEND_RESERVED)) return;
+    ffrdp->cur_new_node->data[0] = FFRDP_FRAME_TYPE_SHORT;
+    ffrdp->cur_new_node->size    = 4 + ffrdp->cur_new_size;
+    SEND_RING_SLOT(ffrdp, ffrdp->send_seq) = ffrdp->cur_new_node;
+    ffrdp->send_seq++; ffrdp->wait_snd++;
+    ffrdp->cur_new_node = NULL;
+    ffrdp->cur_new_size = 0;
+    timer_del(&ffrdp->timer_flush);
+}
+
+static void ffrdp_timer_fire(FFRDPCONTEXT *ffrdp, FFRDP_TIMER *t)
+{
+    if      (t == &ffrdp->timer_flush) ffrdp_flush_new_node(ffrdp);
+    else if (t == &ffrdp->timer_idle ) { if (ffrdp->recv_buff && ffrdp->recv_size == 0) recvbuf_release(ffrdp); }
+    else if (t == &ffrdp->timer_query || t == &ffrdp->timer_dead) return; // disarmed query timer allows next query, dead timer only wakes up caller
+    else timer_link(&ffrdp->timer_due, t); // rto of data frame
+}
+
+static void ffrdp_timer_run(FFRDPCONTEXT *ffrdp, uint32_t now) // fire timers expired at or before now, only non-empty slots and level 1 boundaries are visited
+{
+    FFRDP_TIMER *t, *list;
+    int32_t slot, next, i;
+    while ((int32_t)(now - ffrdp->wheel_tick) >= 0) {
+        if ((ffrdp->wheel_tick & (FFRDP_WHEEL_SLOTS0 - 1)) == 0) { // cascade level 1 slot of this block to level 0
+            slot = FFRDP_WHEEL_SLOTS0 + ((ffrdp->wheel_tick >> FFRDP_WHEEL_BITS0) & (FFRDP_WHEEL_SLOTS1 - 1));
+            ffrdp->wheel_bits[slot / 32] &= ~(1u << (slot % 32));
+            while ((t = ffrdp->wheel[slot])) timer_add(ffrdp, t, t->expire);
+        }
+        slot = ffrdp->wheel_tick & (FFRDP_WHEEL_SLOTS0 - 1);
+        while (ffrdp->wheel_bits[slot / 32] & (1u << (slot % 32))) {
+            ffrdp->wheel_bits[slot / 32] &= ~(1u << (slot % 32));
+            if ((list = ffrdp->wheel[slot])) { ffrdp->wheel[slot] = NULL; list->pprev = &list; }
+            while ((t = list)) { timer_del(t); ffrdp_timer_fire(ffrdp, t); }
+        }
+        next = FFRDP_WHEEL_SLOTS0 - slot; // skip empty slots, stop at next level 1 boundary
+        if ((i = bitmap_find(ffrdp->wheel_bits, (slot + 1) & (FFRDP_WHEEL_SLOTS0 - 1), FFRDP_WHEEL_SLOTS0)) >= 0) next = MIN(next, i + 1);
+        next = MIN(next, (int32_t)(now - ffrdp->wheel_tick) + 1);
+        ffrdp->wheel_tick += next;
     }
-    recv_wnd = (sizeof(ffrdp->recv_buff) - ffrdp->recv_size) / ffrdp->rmss;
-    recv_wnd = MIN(recv_wnd, 255);
-    *(uint32_t*)(data + 0) = (FFRDP_FRAME_TYPE_ACK << 0) | (ffrdp->recv_seq << 8);
-    *(uint32_t*)(data + 4) = (recv_mack <<  0);
-    *(uint32_t*)(data + 4)|= (recv_wnd  << 24);
-    sendto(ffrdp->udp_fd, data, sizeof(data), 0, (struct sockaddr*)dstaddr, sizeof(struct sockaddr_in)); // send ack frame
 }
 
-enum { CEVENT_ACK_OK, CEVENT_ACK_TIMEOUT, CEVENT_FAST_RESEND, CEVENT_SEND_FAILED };
-static void ffrdp_congestion_control(FFRDPCONTEXT *ffrdp, int event)
+#define CAN_SEND_1ST(ffrdp) ((ffrdp)->send_next != (ffrdp)->send_seq && (ffrdp)->wait_snd - ((ffrdp)->send_seq - (ffrdp)->send_next) < (ffrdp)->cc->cwnd(ffrdp)) // frames in flight are below cwnd
+int ffrdp_next_timeout_us(void *ctxt)
+{
+    FFRDPCONTEXT *ffrdp = (FFRDPCONTEXT*)ctxt;
+    int32_t next = -1, t, wait = 0; // us
+    #define UPDATE_NEXT(t) do { if (next < 0 || (t) < next) next = (t); } while (0)
+    if (!ctxt) return -1;
+    if (ffrdp->flags & FLAG_FLUSH) return 0;
+#ifdef CONFIG_ENABLE_PACING
+    wait = ffrdp_pace_wait(ffrdp); // data frames are not sent before pacing allows, timers and query are not paced
+#endif
+    if (ffrdp->timer_due || (CAN_SEND_1ST(ffrdp) && ffrdp->swnd > 0)) UPDATE_NEXT(wait); // resend or first send
+    else if (CAN_SEND_1ST(ffrdp) && !ffrdp->timer_query.pprev) UPDATE_NEXT(0); // query now
+    if ((t = ffrdp_timer_next(ffrdp, get_tick_count())) >= 0) { t = MIN(t, 0x7FFFFFFF / 1000) * 1000; UPDATE_NEXT(t); }
+    return next;
+}
+
+int ffrdp_next_timeout(void *ctxt)
+{
+    int t = ffrdp_next_timeout_us(ctxt);
+    return t > 0 ? (t + 999) / 1000 : t;
+}
+
+int ffrdp_set_pacing_rate(void *ctxt, int rate)
+{
+#ifdef CONFIG_ENABLE_PACING
+    FFRDPCONTEXT *ffrdp = (FFRDPCONTEXT*)ctxt;
+    if (!ffrdp) return -1;
+    ffrdp->pace_rate = rate;
+    return 0;
+#else
+    (void)ctxt; (void)rate;
+    return -1;
+#endif
+}
+
+static SOCKET ffrdp_pollfd(FFRDPCONTEXT *ffrdp)
+{
+    if (ffrdp->flags & FLAG_PEER_RESET) return -1;
+#ifdef CONFIG_ENABLE_IOURING
+    if (ffrdp->flags & FLAG_IOURING) return ffrdp->iour_fd; // datagrams are consumed by multishot recvmsg, wait on completion queue
+#endif
+    return ffrdp->udp_fd;
+}
+
+static void ffrdp_recvdata_and_sendack(FFRDPCONTEXT *ffrdp)
 {
-    switch (event) {
-    case CEVENT_ACK_OK:
-        if (ffrdp->cwnd < ffrdp->ssthresh) ffrdp->cwnd *= 2;
-        else ffrdp->cwnd++;
-        ffrdp->cwnd = MIN(ffrdp->cwnd, FFRDP_MAX_CWND_SIZE);
-        ffrdp->cwnd = MAX(ffrdp->cwnd, FFRDP_MIN_CWND_SIZE);
-        break;
-    case CEVENT_ACK_TIMEOUT:
-    case CEVENT_SEND_FAILED:
-        ffrdp->ssthresh = MAX(ffrdp->cwnd / 2, FFRDP_MIN_CWND_SIZE);
-        ffrdp->cwnd     = FFRDP_MIN_CWND_SIZE;
-        break;
-    case CEVENT_FAST_RESEND:
-        ffrdp->ssthresh = MAX(ffrdp->cwnd / 2, FFRDP_MIN_CWND_SIZE);
-        ffrdp->cwnd     = ffrdp->ssthresh;
-        break;
+    FFRDP_FRAME_NODE *p;
+    int32_t recv_mack, recv_wnd, size, scale = 0;
+    uint8_t data[9];
+    while (RECV_RING_TEST(ffrdp, ffrdp->recv_seq)) { // drain contiguous frames from recv_seq
+        p = RECV_RING_SLOT(ffrdp, ffrdp->recv_seq);
+        if (recvbuf_reserve(ffrdp, (size = frame_payload_size(p))) != 0) break;
+#ifdef CONFIG_ENABLE_AES256
+        if ((ffrdp->flags & FLAG_RX_AES256)) frame_node_encrypt(p, &ffrdp->aes_decrypt_key, AES_DECRYPT);
+#endif
+        ffrdp->recv_tail = ringbuf_write(ffrdp->recv_buff, ffrdp->recv_bufsize, ffrdp->recv_tail, p->data + 4, size);
+        ffrdp->recv_size+= size; ffrdp->recv_tick = get_tick_count();
+        timer_add(ffrdp, &ffrdp->timer_idle, ffrdp->recv_tick + FFRDP_RECVBUF_IDLE + 1);
+        RECV_RING_SLOT(ffrdp, ffrdp->recv_seq) = NULL; RECV_RING_FLIP(ffrdp, ffrdp->recv_seq);
+        ffrdp->recv_seq++; ffrdp->recv_seq &= 0xFFFFFF;
+        frame_node_free(p);
     }
+    recv_mack = recv_ring_bits(ffrdp, ffrdp->recv_seq + 1);
+    recv_wnd = (ffrdp->recv_bufmax - ffrdp->recv_size) / ffrdp->rmss; // recv_buff grows on demand, advertise up to its max size
+    recv_wnd = MAX(0, MIN(recv_wnd, (ffrdp->flags & FLAG_PEER_ACKEXT) ? FFRDP_RECV_RING_SIZE - 1 : 255)); // frames beyond receive ring are dropped
+    while ((recv_wnd >> scale) > 255) scale++; // window scale rounds down, peer never sends more than we can take
+    *(uint32_t*)(data + 0) = ((scale ? FFRDP_FRAME_TYPE_ACKEXT : FFRDP_FRAME_TYPE_ACK) << 0) | (ffrdp->recv_seq << 8);
+    *(uint32_t*)(data + 4) = (recv_mack <<  0);
+    *(uint32_t*)(data + 4)|= ((uint32_t)(recv_wnd >> scale) << 24);
+    data[8] = scale;
+    ffrdp_send_ctrl_frame(ffrdp, data, scale ? 9 : 8); // send ack frame
 }
 
 void ffrdp_update(void *ctxt)
 {
     FFRDPCONTEXT       *ffrdp   = (FFRDPCONTEXT*)ctxt;
-    FFRDP_FRAME_NODE   *node    = NULL, *p = NULL, *t = NULL;
-    struct sockaddr_in *dstaddr = NULL, srcaddr;
-    int32_t  addrlen = sizeof(srcaddr);
-    int32_t  una, mack, ret, got_data = 0, got_query = 0, send_una, send_mack = 0, recv_una, dist, maxack, i;
+    FFRDP_FRAME_NODE   *node    = NULL, *p = NULL;
+    FFRDP_TIMER        *t;
+    struct sockaddr_in  srcaddr;
+    uint32_t seq;
+    int32_t  una, mack, ret, got_data = 0, got_query = 0, send_una, send_mack = 0, dist, maxack, i;
+    uint32_t acked = 0, rttm = (uint32_t)-1, now;
     uint8_t  data[8];
 
     if (!ctxt) return;
-    dstaddr  = ffrdp->flags & FLAG_SERVER ? &ffrdp->client_addr : &ffrdp->server_addr;
-    send_una = ffrdp->send_list_head ? GET_FRAME_SEQ(ffrdp->send_list_head) : 0;
-    recv_una = ffrdp->recv_seq;
-
-    if (ffrdp->cur_new_node && ((int32_t)get_tick_count() - (int32_t)ffrdp->cur_new_tick > FFRDP_FLUSH_TIMEOUT || ffrdp->flags & FLAG_FLUSH)) {
-        ffrdp->cur_new_node->data[0] = FFRDP_FRAME_TYPE_SHORT;
-        ffrdp->cur_new_node->size    = 4 + ffrdp->cur_new_size;
-        list_enqueue(&ffrdp->send_list_head, &ffrdp->send_list_tail, ffrdp->cur_new_node);
-        ffrdp->send_seq++; ffrdp->wait_snd++;
-        ffrdp->cur_new_node = NULL;
-        ffrdp->cur_new_size = 0;
+#ifdef CONFIG_ENABLE_IOURING
+    ffrdp_iour_txdone(ffrdp); // reap sends of last update, frames not sent are restored before timers run
+#endif
+    send_una = ffrdp->send_head & 0xFFFFFF;
+
+    ffrdp_timer_run(ffrdp, get_tick_count()); // rto timers move frames to timer_due, flush timer queues cur_new_node
+    if (ffrdp->flags & FLAG_FLUSH) ffrdp_flush_new_node(ffrdp);
+
+    while ((t = ffrdp->timer_due)) { // resend
+        p = TIMER_NODE(t);
+        if (p->flags & FLAG_ZC_PENDING) { timer_add(ffrdp, t, get_tick_count() + 1); continue; } // frame pinned by zerocopy is still in kernel and waits
+#ifdef CONFIG_ENABLE_PACING
+        if (ffrdp_pace(ffrdp, p) != 0) break;
+#endif
+        if (!(p->flags & FLAG_FAST_RESEND)) ffrdp->cc->on_rto(ffrdp); // fast resend was reported by on_loss when detected
+        if (ffrdp_send_data_frame(ffrdp, p, TXQ_DATA_RESEND) != 0) break;
+        ffrdp_rate_on_send(ffrdp, p, (uint32_t)get_tick_us());
+        if (!(p->flags & FLAG_FAST_RESEND)) {
+            if (ffrdp->rto == FFRDP_MAX_RTO) {
+                p->tick_send = get_tick_count();
+                p->flags    &=~FLAG_TIMEOUT_RESEND;
+                ffrdp->counter_reach_maxrto++;
+            } else p->flags |= FLAG_TIMEOUT_RESEND;
+            ffrdp->rto += ffrdp->rto / 2;
+            ffrdp->rto  = MIN(ffrdp->rto, FFRDP_MAX_RTO);
+            ffrdp->counter_resend_rto++;
+        } else {
+            p->flags &= ~(FLAG_FAST_RESEND|FLAG_TIMEOUT_RESEND);
+            ffrdp->counter_resend_fast++;
+        }
+        p->tick_timeout+= ffrdp->rto;
+        timer_add(ffrdp, t, p->tick_timeout + 1);
     }
 
-    for (i=0,p=ffrdp->send_list_head; i<(int32_t)ffrdp->cwnd&&p; i++,p=p->next) {
-        if (!(p->flags & FLAG_FIRST_SEND)) { // first send
-            if (ffrdp->swnd > 0) {
-                if (ffrdp_send_data_frame(ffrdp, p, dstaddr) != 0) { ffrdp_congestion_control(ffrdp, CEVENT_SEND_FAILED); break; }
-                p->tick_1sts = p->tick_send = get_tick_count();
-                p->tick_timeout = p->tick_send + ffrdp->rto;
-                p->flags       |= FLAG_FIRST_SEND;
-                ffrdp->swnd--; ffrdp->counter_send_1sttime++;
-            } else if (ffrdp->tick_send_query == 0 || (int32_t)get_tick_count() - (int32_t)ffrdp->tick_send_query > FFRDP_QUERY_CYCLE) { // query remote receive window size
-                data[0] = FFRDP_FRAME_TYPE_QUERY; sendto(ffrdp->udp_fd, data, 1, 0, (struct sockaddr*)dstaddr, sizeof(struct sockaddr_in));
+#ifdef CONFIG_ENABLE_LARGE_BDP
+    if (CAN_SEND_1ST(ffrdp) && !(ffrdp->flags & FLAG_PEER_ACKEXT) && ffrdp->ext_tries < FFRDP_EXT_TRIES && (!ffrdp->ext_tries || (int32_t)get_tick_count() - (int32_t)ffrdp->tick_send_ext >= FFRDP_QUERY_CYCLE)) {
+        data[0] = FFRDP_FRAME_TYPE_QUERY; data[1] = FFRDP_QUERY_EXT; ffrdp_send_ctrl_frame(ffrdp, data, 2); // old peer takes it as a query and replies ack
+        ffrdp->tick_send_ext = get_tick_count(); ffrdp->ext_tries++;
+    }
+#endif
+    while (CAN_SEND_1ST(ffrdp)) { // first send
+        p = SEND_RING_SLOT(ffrdp, ffrdp->send_next);
+        if (ffrdp->swnd > 0) {
+#ifdef CONFIG_ENABLE_PACING
+            if (ffrdp_pace(ffrdp, p) != 0) break;
+#endif
+            if (ffrdp_send_data_frame(ffrdp, p, TXQ_DATA_1ST) != 0) break;
+            p->tick_1sts = p->tick_send = get_tick_count();
+            p->tick_timeout = p->tick_send + ffrdp->rto;
+            p->flags       |= FLAG_FIRST_SEND;
+            timer_add(ffrdp, &p->timer, p->tick_timeout + 1);
+            ffrdp_rate_on_send(ffrdp, p, (uint32_t)get_tick_us());
+            if (ffrdp->cc->on_send) ffrdp->cc->on_send(ffrdp, p);
+            if (ffrdp->send_next++ == ffrdp->send_head) timer_add(ffrdp, &ffrdp->timer_dead, p->tick_1sts + FFRDP_DEAD_TIMEOUT + 1);
+            ffrdp->swnd--; ffrdp->counter_send_1sttime++;
+        } else {
+            if (!ffrdp->timer_query.pprev) { // query remote receive window size
+                data[0] = FFRDP_FRAME_TYPE_QUERY; ffrdp_send_ctrl_frame(ffrdp, data, 1);
                 ffrdp->tick_send_query = get_tick_count(); ffrdp->counter_send_query++;
-                break;
-            }
-        } else if ((p->flags & FLAG_FIRST_SEND) && ((int32_t)get_tick_count() - (int32_t)p->tick_timeout > 0 || (p->flags & FLAG_FAST_RESEND))) { // resend
-            ffrdp_congestion_control(ffrdp, CEVENT_ACK_TIMEOUT);
-            if (ffrdp_send_data_frame(ffrdp, p, dstaddr) != 0) break;
-            if (!(p->flags & FLAG_FAST_RESEND)) {
-                if (ffrdp->rto == FFRDP_MAX_RTO) {
-                    p->tick_send = get_tick_count();
-                    p->flags    &=~FLAG_TIMEOUT_RESEND;
-                    ffrdp->counter_reach_maxrto++;
-                } else p->flags |= FLAG_TIMEOUT_RESEND;
-                ffrdp->rto += ffrdp->rto / 2;
-                ffrdp->rto  = MIN(ffrdp->rto, FFRDP_MAX_RTO);
-                ffrdp->counter_resend_rto++;
-            } else {
-                p->flags &= ~(FLAG_FAST_RESEND|FLAG_TIMEOUT_RESEND);
-                ffrdp->counter_resend_fast++;
+                timer_add(ffrdp, &ffrdp->timer_query, ffrdp->tick_send_query + FFRDP_QUERY_CYCLE + 1);
             }
-            p->tick_timeout+= ffrdp->rto;
+            break;
         }
     }
+    if (ffrdp->send_next == ffrdp->send_seq && CC_FLIGHT(ffrdp) < ffrdp->cc->cwnd(ffrdp)) { // sender runs out of data, rate samples of frames sent from now are app limited
+        ffrdp->dlv_applimited = (ffrdp->dlv_bytes + CC_FLIGHT(ffrdp) * ffrdp->smss) | 1;
+    }
 
+    ffrdp_txq_flush(ffrdp); // data frames go out before waiting for incoming frames
     if (ffrdp_sleep(ffrdp, FFRDP_SELECT_SLEEP) != 0) return;
     for (node=NULL;;) { // receive data
-        if (!node && !(node = frame_node_new(FFRDP_FRAME_TYPE_FEC2, FFRDP_MAX_MSS))) break;;
-        if ((ret = recvfrom(ffrdp->udp_fd, node->data, node->size, 0, (struct sockaddr*)&srcaddr, &addrlen)) <= 0) break;
-        if ((ffrdp->flags & FLAG_SERVER) && (ffrdp->flags & FLAG_CONNECTED) == 0) {
+        if ((ret = ffrdp_recv_next(ffrdp, &node, &srcaddr)) <= 0) break;
+        if ((ffrdp->flags & FLAG_SERVER) && (ffrdp->flags & FLAG_UDP_CONNECTED) == 0) {
             if (ffrdp->flags & FLAG_CONNECTED) {
                 if (memcmp(&srcaddr, &ffrdp->client_addr, sizeof(srcaddr)) != 0) continue;
             } else {
                 ffrdp->flags |= FLAG_CONNECTED;
                 memcpy(&ffrdp->client_addr, &srcaddr, sizeof(ffrdp->client_addr));
+#ifdef CONFIG_ENABLE_UDP_CONNECT
+                if (connect(ffrdp->udp_fd, (struct sockaddr*)&ffrdp->client_addr, sizeof(ffrdp->client_addr)) == 0) ffrdp->flags |= FLAG_UDP_CONNECTED; // lock in client
+#endif
             }
         }
 
         if (node->data[0] <= FFRDP_FRAME_TYPE_FEC32) { // data frame
             node->size = ret; // frame size is the return size of recvfrom
             if (ffrdp_recv_data_frame(ffrdp, node) == 0) {
-                dist = seq_distance(GET_FRAME_SEQ(node), recv_una);
-                if (dist == 0) { recv_una++; }
-                if (dist >= 0) { list_enqueue(&ffrdp->recv_list_head, &ffrdp->recv_list_tail, node); node = NULL; }
+                dist = seq_distance(GET_FRAME_SEQ(node), ffrdp->recv_seq);
+                if (dist >= 0 && dist < FFRDP_RECV_RING_SIZE && !RECV_RING_TEST(ffrdp, GET_FRAME_SEQ(node))) { // new frame in receive window
+                    RECV_RING_SLOT(ffrdp, GET_FRAME_SEQ(node)) = node; RECV_RING_FLIP(ffrdp, GET_FRAME_SEQ(node));
+                    node = NULL;
+                }
                 got_data = 1;
             }
-        } else if (node->data[0] == FFRDP_FRAME_TYPE_ACK ) {
+        } else if (node->data[0] == FFRDP_FRAME_TYPE_ACK || (node->data[0] == FFRDP_FRAME_TYPE_ACKEXT && ret >= 9 && node->data[8] < 24)) {
             una  = *(uint32_t*)(node->data + 0) >> 8;
             mack = *(uint32_t*)(node->data + 4) & 0xFFFFFF;
             dist = seq_distance(una, send_una);
             if (dist >= 0) {
                 send_una    = una;
-                send_mack   = (send_mack >> dist) | mack;
+                send_mack   = (dist < 24 ? send_mack >> dist : 0) | mack; // bits of older ack beyond its 24 frame range are gone
                 ffrdp->swnd = node->data[7]; ffrdp->tick_recv_ack = get_tick_count();
+#ifdef CONFIG_ENABLE_LARGE_BDP
+                if (node->data[0] == FFRDP_FRAME_TYPE_ACKEXT) ffrdp->swnd = MIN((uint32_t)node->data[7] << node->data[8], FFRDP_SEND_RING_SIZE); // window scale is negotiated by ext query, never beyond send ring
+#endif
             }
-        } else if (node->data[0] == FFRDP_FRAME_TYPE_QUERY) got_query = 1;
+#ifdef CONFIG_ENABLE_LARGE_BDP
+            if (node->data[0] == FFRDP_FRAME_TYPE_ACKEXT) ffrdp->flags |= FLAG_PEER_ACKEXT;
+#endif
+        } else if (node->data[0] == FFRDP_FRAME_TYPE_QUERY) {
+            got_query = 1;
+#ifdef CONFIG_ENABLE_LARGE_BDP
+            if (ret >= 2 && (node->data[1] & FFRDP_QUERY_EXT)) ffrdp->flags |= FLAG_PEER_ACKEXT;
+#endif
+        }
     }
-    if (node) free(node);
-
-    if (got_data || got_query) ffrdp_recvdata_and_sendack(ffrdp, dstaddr); // send ack frame
-    if (ffrdp->send_list_head && seq_distance(send_una, GET_FRAME_SEQ(ffrdp->send_list_head)) > 0) { // got ack frame
-        for (p=ffrdp->send_list_head; p;) {
-            dist = seq_distance(GET_FRAME_SEQ(p), send_una);
-            for (i=23; i>=0 && !(send_mack&(1<<i)); i--);
-            if (i < 0) maxack = (send_una - 1) & 0xFFFFFF;
-            else maxack = (send_una + i + 1) & 0xFFFFFF;
-
+    if (got_data || got_query) ffrdp_recvdata_and_sendack(ffrdp); // send ack frame
+    ffrdp_txq_flush(ffrdp);
+#ifdef CONFIG_ENABLE_ZEROCOPY
+    ffrdp_zc_complete(ffrdp); // unpin frames of finished zerocopy sends once per update, acked frames are freed here
+#endif
+    if (ffrdp->send_head != ffrdp->send_seq && (dist = seq_distance(send_una, ffrdp->send_head & 0xFFFFFF)) > 0) { // got ack frame
+        una = ffrdp->send_head + dist; // send_una in the same seq space as send_head
+        now = (uint32_t)get_tick_us(); ffrdp->rs_rate = 0; ffrdp->rs_rtt = (uint32_t)-1;
+        for (i=23; i>=0 && !(send_mack&(1<<i)); i--);
+        if (i < 0) maxack = una - 1;
+        else maxack = una + i + 1;
+        for (seq=ffrdp->send_head; (p=send_ring_next(ffrdp, &seq)); seq++) { // visits frames before una and in mack range only
+            dist = (int32_t)(seq - (uint32_t)una);
             if (dist > 24 || !(p->flags & FLAG_FIRST_SEND)) break;
             else if (dist < 0 || (dist > 0 && (send_mack & (1 << (dist-1))))) { // this frame got ack
-                ffrdp->counter_send_bytes += frame_payload_size(p); ffrdp->wait_snd--;
-                ffrdp_congestion_control(ffrdp, CEVENT_ACK_OK);
+                ffrdp->counter_send_bytes += frame_payload_size(p); ffrdp->wait_snd--; acked++;
+                ffrdp_rate_on_ack(ffrdp, p, now);
                 if (!(p->flags & FLAG_TIMEOUT_RESEND)) {
-                    ffrdp->rttm = (int32_t)get_tick_count() - (int32_t)p->tick_send;
+                    ffrdp->rttm = rttm = (int32_t)get_tick_count() - (int32_t)p->tick_send;
                     if (ffrdp->rtts == (uint32_t)-1) {
                         ffrdp->rtts = ffrdp->rttm;
                         ffrdp->rttd = ffrdp->rttm / 2;
@@ -611,13 +2320,18 @@ void ffrdp_update(void *ctxt)
                     ffrdp->rto = MAX(FFRDP_MIN_RTO, ffrdp->rto);
                     ffrdp->rto = MIN(FFRDP_MAX_RTO, ffrdp->rto);
                 }
-                t = p; p = p->next; list_remove(&ffrdp->send_list_head, &ffrdp->send_list_tail, t); continue;
-            } else if (seq_distance(maxack, GET_FRAME_SEQ(p)) > 0) {
-                ffrdp_congestion_control(ffrdp, CEVENT_FAST_RESEND);
+                SEND_RING_SLOT(ffrdp, seq) = NULL; frame_node_free(p);
+            } else if ((int32_t)((uint32_t)maxack - seq) > 0) {
+                ffrdp->cc->on_loss(ffrdp);
                 p->flags |= FLAG_FAST_RESEND;
+                timer_link(&ffrdp->timer_due, &p->timer);
             }
-            p = p->next;
         }
+        send_ring_next(ffrdp, &ffrdp->send_head); // move head over acked slots
+        if (ffrdp->rs_rtt != (uint32_t)-1) ffrdp_delay_update(ffrdp, ffrdp->rs_rtt, get_tick_count());
+        if (acked) ffrdp_cc_on_ack(ffrdp, acked, rttm);
+        if (ffrdp->send_head != ffrdp->send_next) timer_add(ffrdp, &ffrdp->timer_dead, SEND_RING_SLOT(ffrdp, ffrdp->send_head)->tick_1sts + FFRDP_DEAD_TIMEOUT + 1);
+        else timer_del(&ffrdp->timer_dead);
     }
 }
 
@@ -627,6 +2341,34 @@ void ffrdp_flush(void *ctxt)
     if (ffrdp) ffrdp->flags |= FLAG_FLUSH;
 }
 
+int ffrdp_set_recvbuf(void *ctxt, int size, int maxsize)
+{
+    FFRDPCONTEXT *ffrdp = (FFRDPCONTEXT*)ctxt;
+    if (!ffrdp) return -1;
+    ffrdp->recv_bufmin = MAX(FFRDP_MAX_MSS, MIN(size, FFRDP_RECVBUF_MAX));
+    ffrdp->recv_bufmax = MAX(ffrdp->recv_bufmin, MIN(maxsize, FFRDP_RECVBUF_MAX));
+    if (!ffrdp->recv_buff) ffrdp->recv_bufsize = ffrdp->recv_bufmin;
+    else if (ffrdp->recv_size == 0) recvbuf_release(ffrdp); // take effect on next data, otherwise when drained and idle
+    return 0;
+}
+
+int ffrdp_set_target_delay(void *ctxt, int ms)
+{
+    FFRDPCONTEXT *ffrdp = (FFRDPCONTEXT*)ctxt;
+    if (!ffrdp || ms <= 0) return -1;
+    ffrdp->target_delay = (uint32_t)ms * 1000;
+    return 0;
+}
+
+int ffrdp_set_cc(void *ctxt, int cc)
+{
+    FFRDPCONTEXT *ffrdp = (FFRDPCONTEXT*)ctxt;
+    if (!ffrdp || cc < 0 || cc >= (int)(sizeof(g_cc_ops) / sizeof(g_cc_ops[0]))) return -1;
+    ffrdp->cc = &g_cc_ops[cc];
+    ffrdp->cc->init(ffrdp);
+    return 0;
+}
+
 void ffrdp_dump(void *ctxt, int clearhistory)
 {
     FFRDPCONTEXT *ffrdp = (FFRDPCONTEXT*)ctxt; int secs;
@@ -637,12 +2379,21 @@ void ffrdp_dump(void *ctxt, int clearhistory)
     printf("total_send, total_recv: %.2fMB, %.2fMB\n"    , ffrdp->counter_send_bytes / (1024.0 * 1024), ffrdp->counter_recv_bytes / (1024.0 * 1024));
     printf("averg_send, averg_recv: %.2fKB/s, %.2fKB/s\n", ffrdp->counter_send_bytes / (1024.0 * secs), ffrdp->counter_recv_bytes / (1024.0 * secs));
     printf("recv_size           : %d\n"  , ffrdp->recv_size           );
+    printf("recv_bufsize        : %d (%d - %d)%s\n", ffrdp->recv_bufsize, ffrdp->recv_bufmin, ffrdp->recv_bufmax, ffrdp->recv_buff ? "" : ", released");
     printf("flags               : %x\n"  , ffrdp->flags               );
     printf("send_seq            : %u\n"  , ffrdp->send_seq            );
     printf("recv_seq            : %u\n"  , ffrdp->recv_seq            );
     printf("wait_snd            : %u\n"  , ffrdp->wait_snd            );
     printf("rmss, smss          : %u, %u\n"    , ffrdp->rmss, ffrdp->smss);
-    printf("swnd, cwnd, ssthresh: %u, %u, %u\n", ffrdp->swnd, ffrdp->cwnd, ffrdp->ssthresh);
+    printf("swnd, cwnd, ssthresh: %u, %u, %u\n", ffrdp->swnd, ffrdp->cc->cwnd(ffrdp), ffrdp->ssthresh);
+    printf("congestion control  : %s, recovery %u\n", ffrdp->cc->name, ffrdp->cc_state.recovery);
+    printf("qdelay, base, srtt  : %uus, %uus, %uus, max qdelay %uus, target %uus\n", ffrdp->qdelay, ffrdp->base_rtt == (uint32_t)-1 ? 0 : ffrdp->base_rtt, ffrdp->srtt_us, ffrdp->counter_qdelay_max, ffrdp->target_delay);
+    if (ffrdp->cc == &g_cc_ops[FFRDP_CC_BBR]) {
+        printf("bbr mode, btlbw, rtt: %u, %.1fKB/s, %dus\n", ffrdp->cc_state.u.bbr.mode, ffrdp->cc_state.u.bbr.btlbw / 1024.0, (int)ffrdp->cc_state.u.bbr.min_rtt);
+    }
+    printf("cc_ack, cost per ack: %u, %.1fns, last %.1fns\n", ffrdp->counter_cc_ack, (double)ffrdp->counter_cc_ack_ns / MAX(ffrdp->counter_cc_ack, 1),
+        (double)(ffrdp->counter_cc_ack_ns - ffrdp->counter_cc_ack_ns_last) / MAX(ffrdp->counter_cc_ack - ffrdp->counter_cc_ack_last, 1));
+    ffrdp->counter_cc_ack_last = ffrdp->counter_cc_ack; ffrdp->counter_cc_ack_ns_last = ffrdp->counter_cc_ack_ns;
     printf("fec_txredundancy    : %d\n"  , ffrdp->fec_txredundancy    );
     printf("fec_rxredundancy    : %d\n"  , ffrdp->fec_rxredundancy    );
     printf("fec_txseq           : %d\n"  , ffrdp->fec_txseq           );
@@ -662,9 +2413,312 @@ void ffrdp_dump(void *ctxt, int clearhistory)
     printf("counter_fec_tx      : %u\n"  , ffrdp->counter_fec_tx      );
     printf("counter_fec_rx      : %u\n"  , ffrdp->counter_fec_rx      );
     printf("counter_fec_ok      : %u\n"  , ffrdp->counter_fec_ok      );
-    printf("counter_fec_failed  : %u\n\n", ffrdp->counter_fec_failed  );
+    printf("counter_fec_failed  : %u\n"  , ffrdp->counter_fec_failed  );
+    printf("counter_recv_syscall: %u\n"  , ffrdp->counter_recv_syscall);
+    printf("counter_recv_packet : %u\n"  , ffrdp->counter_recv_packet );
+    printf("syscalls_per_packet : %.3f\n"  , (double)ffrdp->counter_recv_syscall / MAX(ffrdp->counter_recv_packet, 1));
+    printf("counter_send_syscall: %u\n"  , ffrdp->counter_send_syscall);
+    printf("counter_send_packet : %u\n"  , ffrdp->counter_send_packet );
+    printf("syscalls_per_sendpkt: %.3f\n"  , (double)ffrdp->counter_send_syscall / MAX(ffrdp->counter_send_packet, 1));
+    printf("counter_zc_send     : %u\n"  , ffrdp->counter_zc_send     );
+    printf("counter_zc_copied   : %u\n"  , ffrdp->counter_zc_copied   );
+    printf("counter_pace_wait   : %u\n"  , ffrdp->counter_pace_wait   );
+#ifdef CONFIG_ENABLE_PACING
+    printf("pacing rate         : %.1fKB/s%s\n", (ffrdp->pace_rate ? MAX(ffrdp->pace_rate, 0) : (int64_t)ffrdp->cc->pacing_rate(ffrdp)) / 1024.0, ffrdp->pace_rate ? " (pinned)" : "");
+#endif
+    printf("pool_free_nodes     : %u\n"  , ffrdp->pool.num            );
+    printf("pool_hit, pool_miss : %u, %u\n\n", ffrdp->pool.hit, ffrdp->pool.miss);
     if (secs > 1 && clearhistory) {
         ffrdp->tick_ffrdp_dump = get_tick_count();
         memset(&ffrdp->counter_send_bytes, 0, (uint8_t*)&ffrdp->reserved - (uint8_t*)&ffrdp->counter_send_bytes);
+        ffrdp->pool.hit = ffrdp->pool.miss = 0;
+    }
+}
+
+typedef struct {
+    FFRDPCONTEXT **ctxts;
+    int32_t        num, size;
+#ifndef WIN32
+    int            epfd, tmfd;
+#endif
+    SOCKET         lsn_fd;     // SO_REUSEPORT listener of this shard, new clients arrive here
+    char           lsn_ip[16];
+    int32_t        lsn_port, lsn_smss, lsn_sfec;
+    char           lsn_txkey[32], lsn_rxkey[32];
+    char          *lsn_ptxkey, *lsn_prxkey;
+    FFRDPCONTEXT **accq;       // contexts accepted but not yet taken by ffrdp_loop_accept
+    int32_t        accnum, accsize;
+} FFRDPLOOP;
+
+void* ffrdp_loop_init(void)
+{
+    FFRDPLOOP *loop = calloc(1, sizeof(FFRDPLOOP));
+#ifndef WIN32
+    struct epoll_event ev;
+    if (!loop) return NULL;
+    loop->lsn_fd = -1;
+    loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+    loop->tmfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    ev.events = EPOLLIN; ev.data.ptr = loop;
+    if (loop->epfd < 0 || loop->tmfd < 0 || epoll_ctl(loop->epfd, EPOLL_CTL_ADD, loop->tmfd, &ev) != 0) {
+        printf("failed to create epoll or timerfd !\n");
+        ffrdp_loop_free(loop);
+        return NULL;
+    }
+#endif
+    return loop;
+}
+
+void ffrdp_loop_free(void *ctxt)
+{
+    FFRDPLOOP *loop = (FFRDPLOOP*)ctxt;
+    if (!ctxt) return;
+    while (loop->accnum > 0) ffrdp_free(loop->accq[--loop->accnum]); // nobody took them
+    while (loop->num > 0) ffrdp_loop_del(loop, loop->ctxts[loop->num - 1]);
+#ifndef WIN32
+    if (loop->lsn_fd >= 0) close(loop->lsn_fd);
+    if (loop->epfd >= 0) close(loop->epfd);
+    if (loop->tmfd >= 0) close(loop->tmfd);
+#endif
+    free(loop->accq);
+    free(loop->ctxts);
+    free(loop);
+}
+
+int ffrdp_loop_add(void *ctxt, void *ffrdpctxt)
+{
+    FFRDPLOOP    *loop  = (FFRDPLOOP   *)ctxt;
+    FFRDPCONTEXT *ffrdp = (FFRDPCONTEXT*)ffrdpctxt;
+    void         *p;
+#ifndef WIN32
+    struct epoll_event ev;
+#endif
+    if (!loop || !ffrdp || ffrdp->loop) return -1;
+    if (loop->num == loop->size) {
+        if (!(p = realloc(loop->ctxts, (loop->size + 16) * sizeof(FFRDPCONTEXT*)))) return -1;
+        loop->ctxts = p; loop->size += 16;
+    }
+    ffrdp->loop_fd = ffrdp_pollfd(ffrdp);
+#ifndef WIN32
+    ev.events = EPOLLIN; ev.data.ptr = ffrdp;
+    if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, ffrdp->loop_fd, &ev) != 0) return -1;
+#endif
+    loop->ctxts[loop->num++] = ffrdp;
+    ffrdp->loop   = loop;
+    ffrdp->flags |= FLAG_EVLOOP | FLAG_READABLE; // update once to start receiving
+    return 0;
+}
+
+int ffrdp_loop_del(void *ctxt, void *ffrdpctxt)
+{
+    FFRDPLOOP    *loop  = (FFRDPLOOP   *)ctxt;
+    FFRDPCONTEXT *ffrdp = (FFRDPCONTEXT*)ffrdpctxt;
+    int i;
+    if (!loop || !ffrdp || ffrdp->loop != loop) return -1;
+    for (i=0; i<loop->num && loop->ctxts[i]!=ffrdp; i++);
+    if (i == loop->num) return -1;
+    loop->ctxts[i] = loop->ctxts[--loop->num];
+#ifndef WIN32
+    epoll_ctl(loop->epfd, EPOLL_CTL_DEL, ffrdp->loop_fd, NULL);
+#endif
+    ffrdp->loop   = NULL;
+    ffrdp->flags &= ~(FLAG_EVLOOP | FLAG_READABLE);
+    return 0;
+}
+
+#ifndef WIN32
+static void ffrdp_loop_reset(FFRDPLOOP *loop, FFRDPCONTEXT *ffrdp) // peer of accepted context came back as a new client, close socket so its datagrams go to listener
+{
+    epoll_ctl(loop->epfd, EPOLL_CTL_DEL, ffrdp->loop_fd, NULL);
+    closesocket(ffrdp->udp_fd);
+    ffrdp->udp_fd  = -1;
+    ffrdp->loop_fd = -1; // fd number may be reused by the new context, ffrdp_loop_del must not touch it
+    ffrdp->flags  |= FLAG_PEER_RESET; // ffrdp_isdead returns 1, caller frees it as usual
+}
+
+static void ffrdp_loop_rxpend(FFRDPCONTEXT *ffrdp, uint8_t *data, int size) // hand datagram received by listener over to context
+{
+    FFRDP_FRAME_NODE *node, **pp;
+    int n;
+    for (n=0,pp=&ffrdp->rxpend; *pp; pp=&(*pp)->next,n++);
+    if (n >= FFRDP_LOOP_MAXRXPEND || size > 4 + FFRDP_MAX_MSS + 2 || !(node = frame_node_new(&ffrdp->pool, FFRDP_FRAME_TYPE_FEC2, FFRDP_MAX_MSS))) return; // dropped, peer resends it
+    memcpy(node->data, data, size);
+    node->size = size;
+    *pp = node;
+    ffrdp->flags |= FLAG_READABLE;
+}
+
+static void ffrdp_loop_newclient(FFRDPLOOP *loop, struct sockaddr_in *addr, uint8_t *data, int size) // create a connected server context for new client, data is its first datagram
+{
+    FFRDPCONTEXT *ffrdp;
+    void         *p;
+    int           i;
+    for (i=0; i<loop->num && ((loop->ctxts[i]->flags & FLAG_PEER_RESET) || memcmp(&loop->ctxts[i]->client_addr, addr, sizeof(*addr)) != 0); i++);
+    if (i < loop->num) {
+        if (!ffrdp_isdead(loop->ctxts[i])) { ffrdp_loop_rxpend(loop->ctxts[i], data, size); return; } // arrived before the client's socket was connected
+        ffrdp_loop_reset(loop, loop->ctxts[i]); // client reconnects from the same address, the dead context gives way
+    }
+    if (loop->num >= FFRDP_LOOP_MAXCLIENTS || loop->accnum >= FFRDP_LOOP_MAXPENDING) return; // spoofed sources must not exhaust fds and memory
+    if (loop->accnum == loop->accsize) {
+        if (!(p = realloc(loop->accq, (loop->accsize + 16) * sizeof(FFRDPCONTEXT*)))) return;
+        loop->accq = p; loop->accsize += 16;
+    }
+    if (!(ffrdp = ffrdp_open(loop->lsn_ip, loop->lsn_port, loop->lsn_ptxkey, loop->lsn_prxkey, 1, loop->lsn_smss, loop->lsn_sfec, addr))) return;
+    if (ffrdp_loop_add(loop, ffrdp) != 0) { ffrdp_free(ffrdp); return; }
+    ffrdp->flags |= FLAG_ACCEPTED;
+    ffrdp_loop_rxpend(ffrdp, data, size); // first datagram is processed by first update, no wait for peer to resend it
+    loop->accq[loop->accnum++] = ffrdp;
+}
+
+static void ffrdp_loop_reconnect(FFRDPLOOP *loop, FFRDPCONTEXT *ffrdp) // dead accepted context got datagrams, peer reconnects from the same address, they go to a new client of loop
+{
+    FFRDP_FRAME_NODE  *node = NULL;
+    struct sockaddr_in srcaddr;
+    int size;
+    while ((size = ffrdp_recv_next(ffrdp, &node, &srcaddr)) > 0) ffrdp_loop_newclient(loop, &ffrdp->client_addr, node->data, size); // first one resets ffrdp, the rest go to the new context
+}
+
+static void ffrdp_loop_newclients(FFRDPLOOP *loop) // datagrams on listener are from new clients
+{
+    struct sockaddr_in addr;
+    socklen_t          addrlen;
+    uint8_t            buf[4 + FFRDP_MAX_MSS + 2];
+    int                size;
+    for (;;) {
+        addrlen = sizeof(addr);
+        if ((size = recvfrom(loop->lsn_fd, (char*)buf, sizeof(buf), 0, (struct sockaddr*)&addr, &addrlen)) < 0) break;
+        if (size > 0) ffrdp_loop_newclient(loop, &addr, buf, size);
+    }
+}
+#endif
+
+int ffrdp_loop_listen(void *ctxt, char *ip, int port, char *txkey, char *rxkey, int smss, int sfec, int shard, int nshards)
+{
+    FFRDPLOOP *loop = (FFRDPLOOP*)ctxt;
+#ifdef WIN32
+    (void)loop; (void)ip; (void)port; (void)txkey; (void)rxkey; (void)smss; (void)sfec; (void)shard; (void)nshards;
+    return -1; // no SO_REUSEPORT
+#else
+    struct sockaddr_in addr;
+    struct epoll_event ev;
+    int opt;
+#ifdef CONFIG_ENABLE_REUSEPORT_CBPF
+    struct sock_filter code[] = { // socket index = hash(client ip, client port) % nshards
+        { BPF_LDX | BPF_B | BPF_MSH, 0, 0, (uint32_t)SKF_NET_OFF + 0  }, // X = ip header length
+        { BPF_LD  | BPF_W | BPF_IND, 0, 0, (uint32_t)SKF_NET_OFF + 0  }, // A = udp source port : dest port
+        { BPF_ST                   , 0, 0, 0                          }, // M[0] = A
+        { BPF_LD  | BPF_W | BPF_ABS, 0, 0, (uint32_t)SKF_NET_OFF + 12 }, // A = ip source address
+        { BPF_LDX | BPF_MEM        , 0, 0, 0                          }, // X = M[0]
+        { BPF_ALU | BPF_XOR | BPF_X, 0, 0, 0                          },
+        { BPF_ALU | BPF_MUL | BPF_K, 0, 0, 2654435761u                },
+        { BPF_ALU | BPF_RSH | BPF_K, 0, 0, 16                         },
+        { BPF_ALU | BPF_MOD | BPF_K, 0, 0, (uint32_t)nshards          },
+        { BPF_RET | BPF_A          , 0, 0, 0                          },
+    };
+    struct sock_fprog prog = { sizeof(code) / sizeof(code[0]), code };
+#endif
+    if (!loop || loop->lsn_fd >= 0 || shard < 0 || shard >= nshards) return -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(port);
+    addr.sin_addr.s_addr = inet_addr(ip);
+    if ((loop->lsn_fd = socket(AF_INET, SOCK_DGRAM, 0)) < 0) return -1;
+    fcntl(loop->lsn_fd, F_SETFL, fcntl(loop->lsn_fd, F_GETFL, 0) | O_NONBLOCK);
+    opt = 1; setsockopt(loop->lsn_fd, SOL_SOCKET, SO_REUSEADDR, (char*)&opt, sizeof(int));
+    opt = 1;
+    if (setsockopt(loop->lsn_fd, SOL_SOCKET, SO_REUSEPORT, (char*)&opt, sizeof(int)) != 0 || bind(loop->lsn_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        printf("failed to bind listener !\n");
+        goto failed;
+    }
+#ifdef CONFIG_ENABLE_REUSEPORT_CBPF
+    if (shard == 0 && nshards > 1 && setsockopt(loop->lsn_fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) != 0) { // program is shared by the whole port group
+        printf("failed to attach reuseport steering program, use kernel hash !\n");
+    }
+#endif
+    ev.events = EPOLLIN; ev.data.ptr = &loop->lsn_fd;
+    if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, loop->lsn_fd, &ev) != 0) goto failed;
+    strncpy(loop->lsn_ip, ip, sizeof(loop->lsn_ip) - 1);
+    loop->lsn_port   = port;
+    loop->lsn_smss   = smss;
+    loop->lsn_sfec   = sfec;
+    loop->lsn_ptxkey = txkey ? memcpy(loop->lsn_txkey, txkey, sizeof(loop->lsn_txkey)) : NULL; // aes256 key is 32 bytes
+    loop->lsn_prxkey = rxkey ? memcpy(loop->lsn_rxkey, rxkey, sizeof(loop->lsn_rxkey)) : NULL;
+    return 0;
+
+failed:
+    close(loop->lsn_fd);
+    loop->lsn_fd = -1;
+    return -1;
+#endif
+}
+
+void* ffrdp_loop_accept(void *ctxt)
+{
+    FFRDPLOOP *loop = (FFRDPLOOP*)ctxt;
+    FFRDPCONTEXT *ffrdp;
+    if (!loop || loop->accnum == 0) return NULL;
+    ffrdp = loop->accq[0];
+    memmove(loop->accq, loop->accq + 1, --loop->accnum * sizeof(FFRDPCONTEXT*));
+    return ffrdp;
+}
+
+int ffrdp_loop_run(void *ctxt, int timeout)
+{
+    FFRDPLOOP    *loop = (FFRDPLOOP*)ctxt;
+    FFRDPCONTEXT *ffrdp;
+    int32_t next = timeout < 0 ? -1 : MIN(timeout, 0x7FFFFFFF / 1000) * 1000, t, n, i, cnt = 0; // us
+#ifdef WIN32
+    struct timeval tv;
+    fd_set rs;
+#else
+    struct epoll_event events[64];
+    struct itimerspec  its;
+    uint64_t expired;
+#endif
+    if (!loop) return -1;
+    for (i=0; i<loop->num; i++) { // find the earliest deadline of all contexts
+        t = (loop->ctxts[i]->flags & FLAG_READABLE) ? 0 : ffrdp_next_timeout_us(loop->ctxts[i]); // us, pacing deadlines are finer than 1ms
+        if (t >= 0 && (next < 0 || t < next)) next = t;
+    }
+
+#ifdef WIN32
+    FD_ZERO(&rs);
+    for (i=0; i<loop->num && i<FD_SETSIZE; i++) FD_SET(loop->ctxts[i]->loop_fd, &rs);
+    tv.tv_sec  = next / 1000000;
+    tv.tv_usec = next % 1000000;
+    if (loop->num == 0) { // select fails at once with WSAEINVAL on empty fd sets, it would spin
+        if (next) Sleep(next < 0 ? INFINITE : (next + 999) / 1000);
+        n = 0;
+    } else n = select(0, &rs, NULL, NULL, next < 0 ? NULL : &tv);
+    for (i=0; n>0 && i<loop->num; i++) {
+        if (FD_ISSET(loop->ctxts[i]->loop_fd, &rs)) loop->ctxts[i]->flags |= FLAG_READABLE;
+    }
+#else
+    memset(&its, 0, sizeof(its));
+    if (next > 0) { // arm timer to the earliest deadline
+        its.it_value.tv_sec  = next / 1000000;
+        its.it_value.tv_nsec = next % 1000000 * 1000;
+    }
+    timerfd_settime(loop->tmfd, 0, &its, NULL);
+    n = epoll_wait(loop->epfd, events, sizeof(events) / sizeof(events[0]), next == 0 ? 0 : timeout);
+    for (i=0; i<n; i++) {
+        if (events[i].data.ptr == loop) { if (read(loop->tmfd, &expired, sizeof(expired))) {} }
+        else if (events[i].data.ptr == &loop->lsn_fd) ffrdp_loop_newclients(loop);
+        else ((FFRDPCONTEXT*)events[i].data.ptr)->flags |= FLAG_READABLE;
+    }
+#endif
+
+    for (i=0; i<loop->num; i++) { // only update contexts which are readable or have expired deadline
+        ffrdp = loop->ctxts[i];
+#ifndef WIN32
+        if ((ffrdp->flags & (FLAG_READABLE | FLAG_ACCEPTED | FLAG_PEER_RESET)) == (FLAG_READABLE | FLAG_ACCEPTED) && ffrdp_isdead(ffrdp)) ffrdp_loop_reconnect(loop, ffrdp); // before update takes them as its own
+#endif
+        if (!(ffrdp->flags & FLAG_READABLE) && ffrdp_next_timeout_us(ffrdp) != 0) continue;
+        ffrdp->flags &= ~FLAG_READABLE;
+        ffrdp_update(ffrdp); cnt++;
+        if (ffrdp->loop_fd != ffrdp_pollfd(ffrdp)) { // io backend changed at runtime, re-register
+            ffrdp_loop_del(loop, ffrdp); ffrdp_loop_add(loop, ffrdp); i--;
+        }
     }
+    return cnt;
 }
@@ -1,14 +1,47 @@
 #ifndef __FFRDP_H__
 #define __FFRDP_H__
 
+#ifdef WIN32
+#include <stddef.h>
+struct iovec { void *iov_base; size_t iov_len; };
+#else
+#include <sys/uio.h>
+#endif
+
+#define FFRDP_CC_NEWRENO 0
+#define FFRDP_CC_CUBIC   1
+#define FFRDP_CC_BBR     2 // model based, bottleneck bandwidth and min rtt, tolerates random loss
+#define FFRDP_CC_LEDBAT  3 // delay based, keeps queueing delay under target set by ffrdp_set_target_delay
+
 void* ffrdp_init  (char *ip, int port, char *txkey, char *rxkey, int server, int smss, int sfec);
 void  ffrdp_free  (void *ctxt);
 int   ffrdp_send  (void *ctxt, char *buf, int len);
 int   ffrdp_recv  (void *ctxt, char *buf, int len);
+int   ffrdp_sendv (void *ctxt, struct iovec *iov, int iovcnt); // gather send, same semantics as ffrdp_send on the concatenated buffers
+int   ffrdp_recvv (void *ctxt, struct iovec *iov, int iovcnt); // scatter recv, fill buffers in order, return total bytes received
+int   ffrdp_send_reserve(void *ctxt, char **ptr, int *len); // get writable space in payload of current frame, valid until ffrdp_send_commit, don't call other ffrdp functions in between
+int   ffrdp_send_commit (void *ctxt, int len); // len bytes were written to reserved space, return bytes committed
+int   ffrdp_recv_peek   (void *ctxt, struct iovec *iov, int n); // get readable data in place without copy, fill at most n (2 is enough) iovecs, return number of iovecs filled, iovecs stay valid across ffrdp_update until ffrdp_recv_consume
+int   ffrdp_recv_consume(void *ctxt, int len); // drop len bytes of readable data after they are parsed in place, return bytes consumed, it invalidates peeked iovecs (also done by ffrdp_recv/ffrdp_recvv)
 int   ffrdp_isdead(void *ctxt);
 void  ffrdp_update(void *ctxt);
+int   ffrdp_next_timeout(void *ctxt); // ms until next rto, flush, query, dead link or pacing deadline, caller can sleep this long before ffrdp_update, -1 if there is none
+int   ffrdp_next_timeout_us(void *ctxt); // same as ffrdp_next_timeout in us, paced frames are due at finer than 1ms
 void  ffrdp_flush (void *ctxt);
 void  ffrdp_dump  (void *ctxt, int clearhistory);
+int   ffrdp_set_cc(void *ctxt, int cc); // select congestion controller FFRDP_CC_*, default is newreno, call it before sending data
+int   ffrdp_set_target_delay(void *ctxt, int ms); // queueing delay target of FFRDP_CC_LEDBAT, default 25ms
+int   ffrdp_set_pacing_rate(void *ctxt, int rate); // pin pacing rate to rate bytes per second, 0 follows congestion controller, < 0 disables pacing
+int   ffrdp_set_recvbuf(void *ctxt, int size, int maxsize); // receive buffer starts at size bytes and grows on demand up to maxsize, it is allocated on first data and released when empty and idle,
+                                                            // advertised window is capped at 255 frames (about 380KB), at receive ring size with CONFIG_ENABLE_LARGE_BDP, more only buffers unread data
+
+void* ffrdp_loop_init(void);
+void  ffrdp_loop_free(void *loop);
+int   ffrdp_loop_add (void *loop, void *ctxt);
+int   ffrdp_loop_del (void *loop, void *ctxt);
+int   ffrdp_loop_run (void *loop, int timeout); // wait at most timeout ms (-1 for infinite), update contexts which are readable or timeout
+int   ffrdp_loop_listen(void *loop, char *ip, int port, char *txkey, char *rxkey, int smss, int sfec, int shard, int nshards); // serve many clients on a SO_REUSEPORT socket, one loop (thread) per shard, linux only
+void* ffrdp_loop_accept(void *loop); // take next client context accepted by ffrdp_loop_run, it's driven by loop and freed by caller, NULL if none
 
 #endif
 
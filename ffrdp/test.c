@@ -1,13 +1,32 @@
+#ifdef WIN32
 #include <windows.h>
+#else
+#define _GNU_SOURCE // for pthread_setaffinity_np
+#include <time.h>
+#include <unistd.h>
+#include <strings.h>
+#endif
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <pthread.h>
 #include "ffrdp.h"
 
+#ifdef WIN32
 #pragma warning(disable:4996) // disable warnings
 #define usleep(t) Sleep((t) / 1000)
 #define get_tick_count GetTickCount
+#else
+#define stricmp  strcasecmp
+#define strtok_s strtok_r
+static uint32_t get_tick_count()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+#endif
 
 static int  g_exit = 0;
 static char server_bind_ip[32]   = "0.0.0.0";
@@ -16,8 +35,35 @@ static int  server_bind_port     = 8000;
 static int  client_cnnt_port     = 8000;
 static int  server_max_send_size = 16 * 1024;
 static int  client_max_send_size = 16 * 1024;
+static int  server_workers       = 0; // > 0: sharded server, one SO_REUSEPORT socket and ffrdp_loop per worker thread
+static int  client_threads       = 1;
+static int  congestion_control   = FFRDP_CC_NEWRENO;
+static char*g_cc_names[]         = { "newreno", "cubic", "bbr", "ledbat" }; // indexed by FFRDP_CC_*
 static pthread_mutex_t g_mutex;
 
+#define MAX_WORKERS 64
+typedef struct {
+    int       idx;
+    void     *loop;
+    void    **conns;
+    int       num, size;
+    volatile uint32_t total_bytes;
+} WORKER;
+static WORKER g_workers[MAX_WORKERS];
+#define MIN_MAX(v, lo, hi) ((v) < (lo) ? (lo) : (v) > (hi) ? (hi) : (v))
+
+static void pin_thread(int cpu)
+{
+#ifdef WIN32
+    SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << (cpu % 32));
+#else
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu % sysconf(_SC_NPROCESSORS_ONLN), &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+}
+
 static void* server_thread(void *param)
 {
     uint8_t *sendbuf= malloc(server_max_send_size);
@@ -38,6 +84,7 @@ static void* server_thread(void *param)
         if (!ffrdp) {
             ffrdp = ffrdp_init(server_bind_ip, server_bind_port, NULL, NULL, 1, 1024, 10);
             if (!ffrdp) { usleep(100 * 1000); continue; }
+            ffrdp_set_cc(ffrdp, congestion_control);
         }
         size = 1 + rand() % server_max_send_size;
 
@@ -77,6 +124,61 @@ done:
     return NULL;
 }
 
+static void* worker_thread(void *param)
+{
+    WORKER  *worker = (WORKER*)param;
+    uint8_t *sendbuf= malloc(server_max_send_size);
+    uint8_t *recvbuf= malloc(client_max_send_size);
+    uint32_t tick_start, total_last = 0, total, i;
+    void    *ffrdp, *p;
+    int      size, ret;
+
+    if (!sendbuf || !recvbuf) {
+        printf("worker failed to allocate send or recv buffer !\n");
+        goto done;
+    }
+
+    pin_thread(worker->idx);
+    tick_start = get_tick_count();
+    while (!g_exit) {
+        ffrdp_loop_run(worker->loop, 1);
+        while ((ffrdp = ffrdp_loop_accept(worker->loop))) { // connections are owned by this worker only, no locks
+            if (worker->num == worker->size) {
+                if (!(p = realloc(worker->conns, (worker->size + 16) * sizeof(void*)))) { ffrdp_free(ffrdp); continue; }
+                worker->conns = p; worker->size += 16;
+            }
+            ffrdp_set_cc(ffrdp, congestion_control);
+            worker->conns[worker->num++] = ffrdp;
+        }
+        for (i=0; i<(uint32_t)worker->num; i++) {
+            ffrdp = worker->conns[i];
+            size  = 1 + rand() % server_max_send_size;
+            ffrdp_send(ffrdp, (char*)sendbuf, size);
+            ret = ffrdp_recv(ffrdp, (char*)recvbuf, client_max_send_size);
+            if (ret > 0) worker->total_bytes += ret;
+            if (ffrdp_isdead(ffrdp)) {
+                ffrdp_free(ffrdp);
+                worker->conns[i--] = worker->conns[--worker->num];
+            }
+        }
+        if (worker->idx == 0 && (int32_t)get_tick_count() - (int32_t)tick_start > 10 * 1000) { // first worker reports aggregate throughput of all workers
+            for (total=0,i=0; i<(uint32_t)server_workers; i++) total += g_workers[i].total_bytes;
+            pthread_mutex_lock(&g_mutex);
+            printf("workers: %d, connections: %d, aggregate recv: %u KB/s\n", server_workers, worker->num, (total - total_last) / ((uint32_t)get_tick_count() - tick_start));
+            pthread_mutex_unlock(&g_mutex);
+            tick_start = get_tick_count();
+            total_last = total;
+        }
+    }
+
+done:
+    for (i=0; i<(uint32_t)worker->num; i++) ffrdp_free(worker->conns[i]);
+    free(worker->conns);
+    free(sendbuf);
+    free(recvbuf);
+    return NULL;
+}
+
 static void* client_thread(void *param)
 {
     uint8_t *sendbuf= malloc(client_max_send_size);
@@ -97,6 +199,7 @@ static void* client_thread(void *param)
         if (!ffrdp) {
             ffrdp = ffrdp_init(client_cnnt_ip, client_cnnt_port, NULL, NULL, 0, 1280, 0);
             if (!ffrdp) { usleep(100 * 1000); continue; }
+            ffrdp_set_cc(ffrdp, congestion_control);
         }
         size = 1 + rand() % client_max_send_size;
 
@@ -140,12 +243,15 @@ done:
 int main(int argc, char *argv[])
 {
     int server_en = 0, client_en = 0, i;
-    pthread_t hserver = 0, hclient = 0;
+    pthread_t hserver = 0, hclient[MAX_WORKERS] = {0}, hworker[MAX_WORKERS] = {0};
     char *str;
 
     if (argc <= 1) {
         printf("ffrdp test program - v1.0.0\n");
-        printf("usage: ffrdp_test --server=ip:port --client=ip:port\n\n");
+        printf("usage: ffrdp_test --server=ip:port --client=ip:port\n");
+        printf("       --workers=n: sharded server with n SO_REUSEPORT worker threads\n");
+        printf("       --clients=n: run n client threads\n");
+        printf("       --cc=name  : congestion control, newreno, cubic, bbr or ledbat, per ack cost of each dump interval is shown by ffrdp_dump with CONFIG_ENABLE_CC_PROFILE\n\n");
         return 0;
     }
 
@@ -168,6 +274,12 @@ int main(int argc, char *argv[])
             server_max_send_size = atoi(argv[i] + 23);
         } else if (strstr(argv[i], "--client_max_send_size=") == argv[i]) {
             client_max_send_size = atoi(argv[i] + 23);
+        } else if (strstr(argv[i], "--workers=") == argv[i]) {
+            server_workers = MIN_MAX(atoi(argv[i] + 10), 0, MAX_WORKERS);
+        } else if (strstr(argv[i], "--clients=") == argv[i]) {
+            client_threads = MIN_MAX(atoi(argv[i] + 10), 1, MAX_WORKERS);
+        } else if (strstr(argv[i], "--cc=") == argv[i]) {
+            for (congestion_control=sizeof(g_cc_names)/sizeof(g_cc_names[0])-1; congestion_control>0 && strcmp(argv[i] + 5, g_cc_names[congestion_control]) != 0; congestion_control--);
         }
     }
 
@@ -177,27 +289,45 @@ int main(int argc, char *argv[])
         printf("server bind ip      : %s\n", server_bind_ip      );
         printf("server bind port    : %d\n", server_bind_port    );
         printf("server_max_send_size: %d\n", server_max_send_size);
+        printf("server_workers      : %d\n", server_workers      );
     }
+    printf("congestion control  : %s\n", g_cc_names[congestion_control]);
     if (client_en) {
         printf("client connect ip   : %s\n", client_cnnt_ip      );
         printf("client connect port : %d\n", client_cnnt_port    );
         printf("client_max_send_size: %d\n", client_max_send_size);
+        printf("client_threads      : %d\n", client_threads      );
     }
 
     pthread_mutex_init(&g_mutex, NULL);
-    if (server_en) pthread_create(&hserver, NULL, server_thread, NULL);
-    if (client_en) pthread_create(&hclient, NULL, client_thread, NULL);
+    if (server_en && server_workers == 0) pthread_create(&hserver, NULL, server_thread, NULL);
+    if (server_en && server_workers >  0) {
+        for (i=0; i<server_workers; i++) { // bind all shards before any client is accepted, so listeners take the first socket indexes of the port group
+            g_workers[i].idx  = i;
+            g_workers[i].loop = ffrdp_loop_init();
+            if (!g_workers[i].loop || ffrdp_loop_listen(g_workers[i].loop, server_bind_ip, server_bind_port, NULL, NULL, 1024, 10, i, server_workers) != 0) {
+                printf("failed to start worker %d !\n", i);
+                server_workers = i; break;
+            }
+        }
+        for (i=0; i<server_workers; i++) pthread_create(&hworker[i], NULL, worker_thread, &g_workers[i]);
+    }
+    for (i=0; client_en && i<client_threads; i++) pthread_create(&hclient[i], NULL, client_thread, NULL);
 
     while (!g_exit) {
         char cmd[256];
-        scanf("%256s", cmd);
+        scanf("%255s", cmd);
         if (stricmp(cmd, "quit") == 0 || stricmp(cmd, "exit") == 0) {
             g_exit = 1;
         }
     }
 
     if (hserver) pthread_join(hserver, NULL);
-    if (hclient) pthread_join(hclient, NULL);
+    for (i=0; i<MAX_WORKERS; i++) {
+        if (hworker[i]) pthread_join(hworker[i], NULL);
+        if (hclient[i]) pthread_join(hclient[i], NULL);
+        ffrdp_loop_free(g_workers[i].loop);
+    }
     pthread_mutex_destroy(&g_mutex);
     return 0;
 }